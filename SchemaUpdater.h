@@ -208,8 +208,6 @@ public:
      */
     void execUpdates(bool interactive)
     {
-        SqlQueryCache::setEnabled(false);
-
         tableVersion table;
         const QString schemaName = m_pluginName.isNull()?tr("Main application"):m_pluginName;
         if (!needsUpdate()) {
@@ -227,6 +225,9 @@ public:
             return;
         }
 
+        // cached statements on our tables are stale after the update, resumes caching when leaving this method
+        const SqlQueryCache::SchemaChangeGuard cacheGuard(QSqlDatabase::database().connectionName(), Sql::tableNames<Schema>());
+
         // step 1: auto-create missing tables
         try {
             createMissingTables();
@@ -292,8 +293,6 @@ public:
                 return;
             }
         }
-
-        SqlQueryCache::setEnabled(true);
     }
 
 protected:
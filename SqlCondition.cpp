@@ -20,6 +20,8 @@
 */
 #include "SqlCondition.h"
 
+#include "SqlSelectQueryBuilder.h"
+
 SqlCondition::SqlCondition(SqlCondition::LogicOperator op) :
   m_compareOp( Equals ),
   m_logicOp( op ),
@@ -30,6 +32,7 @@ SqlCondition::SqlCondition(SqlCondition::LogicOperator op) :
 void SqlCondition::addValueCondition(const QString& column, SqlCondition::CompareOperator op, const QVariant& value)
 {
     Q_ASSERT( !column.isEmpty() );
+    Q_ASSERT( op != In || value.type() == QVariant::List );
     SqlCondition c;
     c.m_compareOp = op;
     if ( (!m_isCaseSensitive) && value.type() == QVariant::String )
@@ -77,6 +80,26 @@ void SqlCondition::addColumnCondition(const QString& column, SqlCondition::Compa
   m_subConditions.push_back( c );
 }
 
+void SqlCondition::addSubQueryCondition(const QString& column, SqlCondition::CompareOperator op, const SqlSelectQueryBuilder& subQuery)
+{
+    Q_ASSERT( !column.isEmpty() );
+    Q_ASSERT( op != Exists && op != NotExists );
+    SqlCondition c;
+    c.m_column = column;
+    c.m_compareOp = op;
+    c.m_subQuery = QSharedPointer<const SqlSelectQueryBuilder>( new SqlSelectQueryBuilder( subQuery ) );
+    m_subConditions.push_back( c );
+}
+
+void SqlCondition::addExistsCondition(SqlCondition::CompareOperator op, const SqlSelectQueryBuilder& subQuery)
+{
+    Q_ASSERT( op == Exists || op == NotExists );
+    SqlCondition c;
+    c.m_compareOp = op;
+    c.m_subQuery = QSharedPointer<const SqlSelectQueryBuilder>( new SqlSelectQueryBuilder( subQuery ) );
+    m_subConditions.push_back( c );
+}
+
 void SqlCondition::addCondition(const SqlCondition& condition)
 {
     m_subConditions.push_back( condition );
@@ -106,3 +129,90 @@ bool SqlCondition::isCaseSensitive() const
 {
     return m_isCaseSensitive;
 }
+
+QVector<SqlCondition> SqlCondition::children() const
+{
+    if ( !m_subQuery )
+        return m_subConditions;
+    // sub-query conditions are leafs, they have no sub-conditions of their own
+    QVector<SqlCondition> conditions;
+    foreach ( const SqlSelectQueryBuilder::CommonTableExpression &cte, m_subQuery->m_commonTableExpressions ) {
+        SqlCondition c;
+        c.m_subQuery = cte.query;
+        conditions.push_back( c );
+        if ( cte.recursiveQuery ) {
+            c.m_subQuery = cte.recursiveQuery;
+            conditions.push_back( c );
+        }
+    }
+    foreach ( const SqlSelectQueryBuilder::JoinInfo &j, m_subQuery->m_joins )
+        conditions.push_back( j.condition );
+    conditions.push_back( m_subQuery->m_whereCondition );
+    conditions.push_back( m_subQuery->m_havingCondition );
+    conditions.push_back( m_subQuery->m_qualifyCondition );
+    return conditions;
+}
+
+bool SqlCondition::hasPlaceholders() const
+{
+    if ( !m_placeholder.isEmpty() )
+        return true;
+    foreach ( const SqlCondition &c, children() ) {
+        if ( c.hasPlaceholders() )
+            return true;
+    }
+    return false;
+}
+
+bool SqlCondition::hasValueLists() const
+{
+    if ( m_compareOp == In && m_comparedValue.isValid() )
+        return true;
+    foreach ( const SqlCondition &c, children() ) {
+        if ( c.hasValueLists() )
+            return true;
+    }
+    return false;
+}
+
+bool SqlCondition::hasSubQueries() const
+{
+    if ( m_subQuery )
+        return true;
+    foreach ( const SqlCondition &c, m_subConditions ) {
+        if ( c.hasSubQueries() )
+            return true;
+    }
+    return false;
+}
+
+void SqlCondition::collectBindValues( QVector<QVariant> &values, ValueListBinding listBinding ) const
+{
+    if ( hasSubConditions() ) {
+        foreach ( const SqlCondition &c, m_subConditions )
+            c.collectBindValues( values, listBinding );
+        return;
+    }
+    // keep in sync with SqlConditionalQueryBuilderBase::conditionToString()
+    if ( m_subQuery ) {
+        SqlSelectQueryBuilder subQuery( *m_subQuery );
+        subQuery.collectBindValues();
+        values += subQuery.m_bindValues;
+        return;
+    }
+    if ( m_compareOp == In && m_comparedValue.isValid() && listBinding == BindValueListElements ) {
+        foreach ( const QVariant &value, m_comparedValue.toList() )
+            values.push_back( value );
+        return;
+    }
+    if ( m_comparedColumn.isEmpty() && m_comparedValue.isValid() && m_comparedValue.userType() != qMetaTypeId<SqlNowType>() )
+        values.push_back( m_comparedValue );
+}
+
+void SqlCondition::collectPlaceholders( QStringList &placeholders ) const
+{
+    if ( !m_placeholder.isEmpty() )
+        placeholders.push_back( m_placeholder );
+    foreach ( const SqlCondition &c, children() )
+        c.collectPlaceholders( placeholders );
+}
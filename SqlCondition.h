@@ -25,7 +25,9 @@
 #include "sqlate_export.h"
 #include "SqlInternals_p.h"
 
+#include <QSharedPointer>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 #include <QVector>
 
@@ -48,6 +50,8 @@ Q_DECLARE_METATYPE(SqlNowType)
 /** Dummy type for compile time warnings about usage of client side time. */
 struct UsageOfClientSideTime {};
 
+class SqlSelectQueryBuilder;
+
 
 /** Represents a part of a SQL WHERE expression. */
 class SQLATE_EXPORT SqlCondition
@@ -63,7 +67,16 @@ public:
         LessOrEqual,
         Greater,
         GreaterOrEqual,
-        Like
+        Like,
+        In, ///< compares with a QVariantList of values or a sub-query, see Sql::in()
+        Exists, ///< checks if a sub-query returns any rows, see Sql::exists()
+        NotExists
+    };
+
+    /** How collectBindValues() passes the values of In conditions. */
+    enum ValueListBinding {
+        BindValueListAsArray, ///< one bound value for the entire list
+        BindValueListElements ///< one bound value per element
     };
 
     /** Logic operation to combine multiple conditions. */
@@ -131,6 +144,26 @@ public:
         addColumnCondition(column1.name(), op, column2.name());
     }
 
+    /**
+      Add a condition which compares a column with the result of a sub-query, e.g. "column IN (SELECT ...)".
+      @param column The column that should be compared.
+      @param op The operator used for comparison, the sub-query has to return a single row for operators other than In.
+      @param subQuery The sub-query, its bound values are renumbered when it is rendered as part of another query.
+    */
+    void addSubQueryCondition( const QString &column, CompareOperator op, const SqlSelectQueryBuilder &subQuery );
+    template <typename Column>
+    inline void addSubQueryCondition( const Column &column, CompareOperator op, const SqlSelectQueryBuilder &subQuery )
+    {
+        addSubQueryCondition( column.name(), op, subQuery );
+    }
+
+    /**
+      Add an EXISTS or NOT EXISTS condition.
+      @param op Exists or NotExists
+      @param subQuery The sub-query, usually referring to columns of the outer query in its WHERE condition.
+    */
+    void addExistsCondition( CompareOperator op, const SqlSelectQueryBuilder &subQuery );
+
     /**
       Set the case sensitive flag. This is defaulted to true and must be set before calling @func addCondition() or @func addPlaceholderCondition().
       @param isCasesensitive the operands are converted to the same case before comparison
@@ -161,13 +194,44 @@ public:
      */
     bool hasSubConditions() const;
 
+    /**
+     * Checks if this condition or any of its sub-conditions uses a placeholder.
+     */
+    bool hasPlaceholders() const;
+
+    /**
+     * Checks if this condition or any of its sub-conditions compares with a list of values.
+     */
+    bool hasValueLists() const;
+
+    /**
+     * Checks if this condition or any of its sub-conditions contains a sub-query.
+     */
+    bool hasSubQueries() const;
+
+    /**
+     * Appends the values this condition binds to @p values, in the order the query builders assign placeholders.
+     * This allows re-using a statement rendered earlier for a condition of the same structure.
+     * @param listBinding has to match how the query builder rendered In conditions for the used database.
+     */
+    void collectBindValues( QVector<QVariant> &values, ValueListBinding listBinding = BindValueListAsArray ) const;
+
+    /**
+     * Appends the names of the placeholders used in this condition to @p placeholders, in the order they were added.
+     */
+    void collectPlaceholders( QStringList &placeholders ) const;
+
 private:
+    /** Returns the sub-conditions, or the JOIN and WHERE conditions of m_subQuery. */
+    QVector<SqlCondition> children() const;
+
     friend class SqlConditionalQueryBuilderBase;
     QVector<SqlCondition> m_subConditions;
     QString m_column;
     QString m_comparedColumn;
     QString m_placeholder;
     QVariant m_comparedValue;
+    QSharedPointer<const SqlSelectQueryBuilder> m_subQuery;
     CompareOperator m_compareOp;
     LogicOperator m_logicOp;
     bool m_isCaseSensitive;
@@ -178,6 +242,7 @@ template <typename SubConditionList, SqlCondition::LogicOperator> struct Conditi
 template <typename Lhs, SqlCondition::CompareOperator, typename Rhs> struct ConditionColumnLeaf;
 template <typename Lhs, SqlCondition::CompareOperator, typename Rhs> struct ConditionValueLeaf;
 template <typename Lhs, SqlCondition::CompareOperator, typename Rhs> struct ConditionPlaceholderLeaf;
+template <typename Lhs, SqlCondition::CompareOperator, typename Rhs> struct ConditionSubQueryLeaf;
 
 namespace detail {
 
@@ -203,6 +268,18 @@ void append_condition( SqlCondition &cond, const ConditionPlaceholderLeaf<Lhs, C
     cond.addPlaceholderCondition( Lhs::name(), Comp, leaf.placeholder );
 }
 
+template <typename Lhs, SqlCondition::CompareOperator Comp, typename Rhs>
+void append_condition( SqlCondition &cond, const ConditionSubQueryLeaf<Lhs, Comp, Rhs> &leaf )
+{
+    cond.addCondition( leaf.condition );
+}
+
+template <typename SubConditionList, SqlCondition::LogicOperator Op>
+void append_condition( SqlCondition &cond, const ConditionExpr<SubConditionList, Op> &expr )
+{
+    cond.addCondition( expr.condition );
+}
+
 /**
  * Metafunction to identify condition expressions.
  * @internal
@@ -298,15 +375,35 @@ struct ConditionPlaceholderLeaf : ConditionLeaf<ConditionPlaceholderLeaf, Lhs, C
     QString placeholder;
 };
 
+/**
+ * Represents a single sub-query condition, see Sql::exists() and Sql::in().
+ * @internal
+ * @tparam Rhs the type of the sub-query expression
+ */
+template <typename Lhs, SqlCondition::CompareOperator Comp, typename Rhs>
+struct ConditionSubQueryLeaf : ConditionLeaf<ConditionSubQueryLeaf, Lhs, Comp, Rhs>
+{
+    SqlCondition condition;
+};
+
 /**
  * Create a placeholder in conditional expressions for later binding.
  * @param name The placeholder name.
  */
 struct placeholder {
-    explicit placeholder( const QString &name ) : m_name( name ) {}
-    explicit placeholder( const char* name ) : m_name( QString::fromLatin1( name ) ) {}
+    explicit placeholder( const QString &name ) : m_name( normalized( name ) ) {}
+    explicit placeholder( const char* name ) : m_name( normalized( QString::fromLatin1( name ) ) ) {}
 
     QString m_name;
+
+private:
+    /// the leading ':' is optional
+    static QString normalized( const QString &name )
+    {
+        if ( name.startsWith( QLatin1Char( ':' ) ) )
+            return name;
+        return QLatin1Char( ':' ) + name;
+    }
 };
 
 /**
@@ -341,6 +438,31 @@ struct ConditionExpr
         return newCond;
     }
 
+    /**
+     * Logic operators to combine this expression with another leaf using the other operator, which nests this expression.
+     */
+    template <typename Leaf2>
+    typename boost::enable_if_c<(LogicOp == SqlCondition::Or), ConditionExpr<boost::mpl::vector<ConditionExpr, Leaf2>, SqlCondition::And> >::type
+    operator&&( const Leaf2 &l2 ) const
+    {
+        ConditionExpr<boost::mpl::vector<ConditionExpr, Leaf2>, SqlCondition::And> newCond;
+        newCond.condition.setLogicOperator( SqlCondition::And );
+        detail::append_condition( newCond.condition, *this );
+        detail::append_condition( newCond.condition, l2 );
+        return newCond;
+    }
+
+    template <typename Leaf2>
+    typename boost::enable_if_c<(LogicOp == SqlCondition::And), ConditionExpr<boost::mpl::vector<ConditionExpr, Leaf2>, SqlCondition::Or> >::type
+    operator||( const Leaf2 &l2 ) const
+    {
+        ConditionExpr<boost::mpl::vector<ConditionExpr, Leaf2>, SqlCondition::Or> newCond;
+        newCond.condition.setLogicOperator( SqlCondition::Or );
+        detail::append_condition( newCond.condition, *this );
+        detail::append_condition( newCond.condition, l2 );
+        return newCond;
+    }
+
     SqlCondition condition;
 };
 
@@ -530,6 +652,27 @@ like( const ColumnT &, const QString &pattern )
     return c;
 }
 
+/**
+ * Creates an IN condition, matching any of the elements in @p values.
+ * On PostgreSQL the entire list is bound as one array parameter ("column = ANY(:n)"),
+ * so the statement is the same for any number of values.
+ * @tparam ColumnT The column type.
+ * @tparam Container A container of values of the column type, such as QVector or QList.
+ */
+template <typename ColumnT, typename Container>
+ConditionValueLeaf<ColumnT, SqlCondition::In, Container>
+in( const ColumnT &, const Container &values )
+{
+    BOOST_MPL_ASSERT(( boost::is_same<typename Container::value_type, typename ColumnT::type> )); // only compare with values of the column type
+    QVariantList list;
+    list.reserve( values.size() );
+    foreach ( const typename Container::value_type &value, values )
+        list.push_back( QVariant::fromValue( value ) );
+    ConditionValueLeaf<ColumnT, SqlCondition::In, Container> c;
+    c.value = list;
+    return c;
+}
+
 }
 
 Q_DECLARE_TYPEINFO( SqlCondition, Q_MOVABLE_TYPE );
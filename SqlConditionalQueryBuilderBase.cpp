@@ -21,6 +21,7 @@
 #include "SqlConditionalQueryBuilderBase.h"
 
 #include "SqlExceptions.h"
+#include "SqlSelectQueryBuilder.h"
 
 #include <QStringList>
 
@@ -42,6 +43,12 @@ QString SqlConditionalQueryBuilderBase::registerBindValue(const QVariant& value)
 
 }
 
+void SqlConditionalQueryBuilderBase::bindQueryValues()
+{
+    for ( int i = 0; i < m_bindValues.size(); ++i )
+        bindValue( m_bindedValuesOffset + i, m_bindValues.at( i ) );
+}
+
 static QString logicOperatorToString( SqlCondition::LogicOperator op )
 {
     switch ( op ) {
@@ -64,6 +71,9 @@ static QString compareOperatorToString( SqlCondition::CompareOperator op )
         case SqlCondition::Greater: return QLatin1String( " > " );
         case SqlCondition::GreaterOrEqual: return QLatin1String( " >= " );
         case SqlCondition::Like: return QLatin1String( " LIKE " );
+        case SqlCondition::In: return QLatin1String( " IN " );
+        case SqlCondition::Exists: return QLatin1String( "EXISTS " );
+        case SqlCondition::NotExists: return QLatin1String( "NOT EXISTS " );
     }
     qFatal( "Unknown compare operator." );
     return QString();
@@ -78,6 +88,21 @@ QString SqlConditionalQueryBuilderBase::conditionToString(const SqlCondition& co
     if ( conds.size() == 1 )
         return conds.first();
     return QLatin1Char( '(' ) + conds.join( logicOperatorToString( condition.m_logicOp ) ) + QLatin1Char( ')' );
+  } else if ( condition.m_subQuery ) {
+    return condition.m_column + compareOperatorToString( condition.m_compareOp ) + QLatin1Char( '(' ) + subQueryToString( *condition.m_subQuery ) + QLatin1Char( ')' );
+  } else if ( condition.m_compareOp == SqlCondition::In && condition.m_comparedColumn.isEmpty() ) {
+    if ( !condition.m_placeholder.isEmpty() )
+        return condition.m_column + QLatin1String( " = ANY(" ) + condition.m_placeholder + QLatin1Char( ')' );
+    if ( valueListBinding() == SqlCondition::BindValueListAsArray )
+        return condition.m_column + QLatin1String( " = ANY(" ) + registerBindValue( condition.m_comparedValue ) + QLatin1Char( ')' );
+    // one placeholder per value, so the statement changes with the number of values
+    const QVariantList values = condition.m_comparedValue.toList();
+    if ( values.isEmpty() )
+        return QLatin1String( "1 = 0" );
+    QStringList placeholders;
+    foreach ( const QVariant &value, values )
+        placeholders.push_back( registerBindValue( value ) );
+    return condition.m_column + QLatin1String( " IN (" ) + placeholders.join( QLatin1String( ", " ) ) + QLatin1Char( ')' );
   } else {
     QString stmt = condition.m_column;
     stmt += compareOperatorToString( condition.m_compareOp );
@@ -99,3 +124,59 @@ QString SqlConditionalQueryBuilderBase::conditionToString(const SqlCondition& co
   }
 }
 
+QString SqlConditionalQueryBuilderBase::subQueryToString(const SqlSelectQueryBuilder& subQuery)
+{
+    // let the sub-query number its placeholders where ours end, then take over its values in that order
+    SqlSelectQueryBuilder qb( subQuery );
+    qb.m_bindedValuesOffset = m_bindedValuesOffset + m_bindValues.size();
+    const QString stmt = qb.toString();
+    foreach ( const QVariant &value, qb.m_bindValues )
+        registerBindValue( value );
+    return stmt;
+}
+
+QString SqlConditionalQueryBuilderBase::columnAlias(const QString& column, QStringList& columns)
+{
+    int index = columns.indexOf( column );
+    if ( index < 0 ) {
+        index = columns.size();
+        columns.push_back( column );
+    }
+    return QLatin1String( "sqlate_c" ) + QString::number( index );
+}
+
+SqlCondition SqlConditionalQueryBuilderBase::aliasedCondition(const SqlCondition& condition, QStringList& columns)
+{
+    SqlCondition aliased( condition );
+    if ( condition.hasSubConditions() ) {
+        for ( int i = 0; i < aliased.m_subConditions.size(); ++i )
+            aliased.m_subConditions[i] = aliasedCondition( condition.m_subConditions.at( i ), columns );
+        return aliased;
+    }
+    if ( !condition.m_column.isEmpty() )
+        aliased.m_column = columnAlias( condition.m_column, columns );
+    if ( !condition.m_comparedColumn.isEmpty() )
+        aliased.m_comparedColumn = columnAlias( condition.m_comparedColumn, columns );
+    return aliased;
+}
+
+void SqlConditionalQueryBuilderBase::hashCondition(Fingerprint& fingerprint, const SqlCondition& condition) const
+{
+    if ( condition.hasSubConditions() ) {
+        fingerprint << condition.m_subConditions.size() << condition.m_logicOp;
+        foreach ( const SqlCondition &c, condition.m_subConditions )
+            hashCondition( fingerprint, c );
+    } else {
+        fingerprint << 0 << condition.m_column << condition.m_compareOp << condition.m_comparedColumn
+                    << condition.m_placeholder << condition.m_comparedValue;
+        if ( condition.m_compareOp == SqlCondition::In && valueListBinding() == SqlCondition::BindValueListElements )
+            fingerprint << condition.m_comparedValue.toList().size();
+        if ( condition.m_subQuery )
+            fingerprint << condition.m_subQuery->fingerprint();
+    }
+}
+
+SqlCondition::ValueListBinding SqlConditionalQueryBuilderBase::valueListBinding() const
+{
+    return supportsArrayBinding( m_db ) ? SqlCondition::BindValueListAsArray : SqlCondition::BindValueListElements;
+}
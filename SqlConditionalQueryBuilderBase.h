@@ -47,6 +47,24 @@ protected:
 
     QString conditionToString( const SqlCondition &condition );
 
+    /** Renders @p subQuery for use inside this query, registering its bound values after the ones registered so far. */
+    QString subQueryToString( const SqlSelectQueryBuilder &subQuery );
+
+    /** Returns the name for @p column in a derived table selecting @p columns, appending @p column to @p columns if necessary. */
+    static QString columnAlias( const QString &column, QStringList &columns );
+
+    /** Returns a copy of @p condition referring to the columns of a derived table selecting @p columns, see columnAlias(). */
+    static SqlCondition aliasedCondition( const SqlCondition &condition, QStringList &columns );
+
+    /** Adds the structure of @p condition to @p fingerprint, see conditionToString(). */
+    void hashCondition( Fingerprint &fingerprint, const SqlCondition &condition ) const;
+
+    /** Returns how conditionToString() binds the values of SqlCondition::In conditions on this database. */
+    SqlCondition::ValueListBinding valueListBinding() const;
+
+    /** Binds all values registered with registerBindValue() to m_query. */
+    /*reimp*/ void bindQueryValues();
+
 protected:
     SqlCondition m_whereCondition;
     QVector<QVariant> m_bindValues;
@@ -0,0 +1,402 @@
+/*
+    Copyright (C) 2013 Klarälvdalens Datakonsult AB,
+        a KDAB Group company, info@kdab.net,
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+#include "SqlCopyLoader.h"
+
+#include "SqlCondition.h"
+#include "SqlExceptions.h"
+#include "SqlGlobal.h"
+
+#include <QDateTime>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QUuid>
+#include <QtEndian>
+
+#ifdef SQLATE_HAVE_POSTGRESQL
+#include <libpq-fe.h>
+#endif
+
+#include <cstring>
+
+static const int DefaultBufferSize = 1024 * 1024;
+
+static SqlException copyError( const QString &message )
+{
+    return SqlException( QSqlError( QLatin1String( "COPY failed" ), message, QSqlError::StatementError ) );
+}
+
+SqlCopyLoader::SqlCopyLoader(const QSqlDatabase& db) :
+    m_db( db ),
+    m_format( TextFormat ),
+    m_bufferSize( DefaultBufferSize ),
+    m_batchBytes( 0 ),
+    m_insert( 0 ),
+    m_connection( 0 ),
+    m_rowCount( 0 ),
+    m_elapsed( 0 ),
+    m_started( false ),
+    m_finished( false )
+{
+}
+
+SqlCopyLoader::~SqlCopyLoader()
+{
+    if ( m_started && !m_finished )
+        abort();
+    delete m_insert;
+}
+
+void SqlCopyLoader::setTable(const QString& tableName)
+{
+    Q_ASSERT( !m_started );
+    m_table = tableName;
+}
+
+void SqlCopyLoader::addColumn(const QString& columnName)
+{
+    Q_ASSERT( !m_started );
+    m_columns.push_back( columnName );
+}
+
+void SqlCopyLoader::setFormat(SqlCopyLoader::Format format)
+{
+    Q_ASSERT( !m_started );
+    m_format = format;
+}
+
+void SqlCopyLoader::setBufferSize(int bytes)
+{
+    m_bufferSize = qMax( 1024, bytes );
+}
+
+bool SqlCopyLoader::isCopySupported(const QSqlDatabase& db)
+{
+#ifdef SQLATE_HAVE_POSTGRESQL
+    const QVariant handle = db.driver()->handle();
+    return handle.isValid() && qstrcmp( handle.typeName(), "PGconn*" ) == 0;
+#else
+    Q_UNUSED( db );
+    return false;
+#endif
+}
+
+void SqlCopyLoader::start()
+{
+    Q_ASSERT( !m_table.isEmpty() );
+    Q_ASSERT( !m_columns.isEmpty() );
+    m_timer.start();
+    // reserving makes resizing m_row to 0 keep its memory
+    m_row.reserve( 256 );
+
+#ifdef SQLATE_HAVE_POSTGRESQL
+    if ( isCopySupported( m_db ) ) {
+        PGconn *conn = *static_cast<PGconn* const*>( m_db.driver()->handle().constData() );
+        QString stmt = QLatin1String( "COPY " ) % m_table % QLatin1String( " (" ) % m_columns.join( QLatin1String( ", " ) ) % QLatin1String( ") FROM STDIN" );
+        if ( m_format == BinaryFormat )
+            stmt += QLatin1String( " WITH (FORMAT binary)" );
+
+        PGresult *result = PQexec( conn, stmt.toUtf8().constData() );
+        const bool ok = PQresultStatus( result ) == PGRES_COPY_IN;
+        PQclear( result );
+        if ( !ok )
+            throw copyError( QString::fromUtf8( PQerrorMessage( conn ) ) );
+        m_connection = conn;
+
+        if ( m_format == BinaryFormat ) {
+            // signature, flags field and header extension length
+            m_buffer.append( "PGCOPY\n\377\r\n\0", 11 );
+            m_buffer.append( QByteArray( 8, '\0' ) );
+        }
+        m_started = true;
+        return;
+    }
+#endif
+
+    startInsertBatch();
+    m_started = true;
+}
+
+void SqlCopyLoader::startInsertBatch()
+{
+    delete m_insert;
+    m_insert = new SqlInsertQueryBuilder( m_db );
+    m_insert->setTable( m_table );
+    foreach ( const QString &column, m_columns )
+        m_insert->addColumn( column );
+}
+
+void SqlCopyLoader::addRow(const QVector<QVariant>& values)
+{
+    Q_ASSERT( !m_finished );
+    Q_ASSERT( values.size() == m_columns.size() );
+    if ( !m_started )
+        start();
+
+    if ( m_connection ) {
+        m_row.resize( 0 );
+        if ( m_format == BinaryFormat )
+            encodeBinary( values );
+        else
+            encodeText( values );
+        m_buffer += m_row;
+    } else {
+        m_insert->addRow( values );
+        // rough estimate of the memory used, good enough for bounding the batch size
+        m_batchBytes += 16 * values.size();
+    }
+    ++m_rowCount;
+
+    if ( ( m_connection ? m_buffer.size() : m_batchBytes ) >= m_bufferSize )
+        flush();
+}
+
+void SqlCopyLoader::addRow(const QList<Sql::ColumnValue>& values)
+{
+    QVector<QVariant> row( m_columns.size() );
+    foreach ( const Sql::ColumnValue &value, values ) {
+        const int index = m_columns.indexOf( value.columnName );
+        Q_ASSERT( index >= 0 );
+        if ( index >= 0 )
+            row[index] = value.value;
+    }
+    addRow( row );
+}
+
+void SqlCopyLoader::flush()
+{
+#ifdef SQLATE_HAVE_POSTGRESQL
+    if ( m_connection ) {
+        PGconn *conn = static_cast<PGconn*>( m_connection );
+        if ( !m_buffer.isEmpty() && PQputCopyData( conn, m_buffer.constData(), m_buffer.size() ) != 1 ) {
+            const QString message = QString::fromUtf8( PQerrorMessage( conn ) );
+            abort();
+            throw copyError( message );
+        }
+        m_buffer.clear();
+        return;
+    }
+#endif
+
+    if ( m_insert && m_insert->rowCount() > 0 ) {
+        m_insert->exec();
+        startInsertBatch();
+    }
+    m_batchBytes = 0;
+}
+
+qint64 SqlCopyLoader::finish()
+{
+    Q_ASSERT( !m_finished );
+    if ( !m_started ) {
+        m_finished = true;
+        return 0;
+    }
+
+#ifdef SQLATE_HAVE_POSTGRESQL
+    if ( m_connection ) {
+        if ( m_format == BinaryFormat ) {
+            const qint16 trailer = qToBigEndian<qint16>( -1 );
+            m_buffer.append( reinterpret_cast<const char*>( &trailer ), sizeof( trailer ) );
+        }
+        flush();
+
+        PGconn *conn = static_cast<PGconn*>( m_connection );
+        m_connection = 0;
+        m_finished = true;
+        QString error;
+        if ( PQputCopyEnd( conn, 0 ) != 1 )
+            error = QString::fromUtf8( PQerrorMessage( conn ) );
+        while ( PGresult *result = PQgetResult( conn ) ) {
+            if ( PQresultStatus( result ) != PGRES_COMMAND_OK && error.isEmpty() )
+                error = QString::fromUtf8( PQresultErrorMessage( result ) );
+            PQclear( result );
+        }
+        m_elapsed = m_timer.elapsed();
+        if ( !error.isEmpty() )
+            throw copyError( error );
+        return m_rowCount;
+    }
+#endif
+
+    m_finished = true;
+    if ( m_insert->rowCount() > 0 )
+        m_insert->exec();
+    m_elapsed = m_timer.elapsed();
+    return m_rowCount;
+}
+
+void SqlCopyLoader::abort()
+{
+#ifdef SQLATE_HAVE_POSTGRESQL
+    if ( m_connection ) {
+        PGconn *conn = static_cast<PGconn*>( m_connection );
+        m_connection = 0;
+        PQputCopyEnd( conn, "aborted by client" );
+        while ( PGresult *result = PQgetResult( conn ) )
+            PQclear( result );
+    }
+#endif
+    m_buffer.clear();
+    m_finished = true;
+}
+
+qint64 SqlCopyLoader::elapsed() const
+{
+    if ( m_finished )
+        return m_elapsed;
+    return m_started ? m_timer.elapsed() : 0;
+}
+
+double SqlCopyLoader::rowsPerSecond() const
+{
+    const qint64 msecs = elapsed();
+    if ( msecs <= 0 )
+        return 0.0;
+    return m_rowCount * 1000.0 / msecs;
+}
+
+static QByteArray textValue( const QVariant &value )
+{
+    switch ( value.userType() ) {
+    case QMetaType::Bool:
+        return value.toBool() ? QByteArray( "t" ) : QByteArray( "f" );
+    case QMetaType::QDateTime:
+        return value.toDateTime().toUTC().toString( QLatin1String( "yyyy-MM-dd HH:mm:ss.zzz" ) ).toLatin1() + "+00";
+    case QMetaType::QDate:
+        return value.toDate().toString( Qt::ISODate ).toLatin1();
+    case QMetaType::QTime:
+        return value.toTime().toString( QLatin1String( "HH:mm:ss.zzz" ) ).toLatin1();
+    case QMetaType::QByteArray:
+        return "\\x" + value.toByteArray().toHex();
+    case QMetaType::Float:
+        return QByteArray::number( value.toFloat(), 'g', 9 );
+    case QMetaType::Double:
+        return QByteArray::number( value.toDouble(), 'g', 17 );
+    }
+    if ( value.userType() == qMetaTypeId<QUuid>() )
+        return value.value<QUuid>().toByteArray();
+    if ( value.userType() == qMetaTypeId<SqlNowType>() )
+        throw copyError( QLatin1String( "SqlNow can't be used with COPY" ) );
+    return value.toString().toUtf8();
+}
+
+void SqlCopyLoader::encodeText(const QVector<QVariant>& values)
+{
+    for ( int i = 0; i < values.size(); ++i ) {
+        if ( i > 0 )
+            m_row += '\t';
+        const QVariant &value = values.at( i );
+        if ( value.isNull() ) {
+            m_row += "\\N";
+            continue;
+        }
+        const QByteArray text = textValue( value );
+        for ( int j = 0; j < text.size(); ++j ) {
+            const char c = text.at( j );
+            switch ( c ) {
+            case '\\': m_row += "\\\\"; break;
+            case '\t': m_row += "\\t"; break;
+            case '\n': m_row += "\\n"; break;
+            case '\r': m_row += "\\r"; break;
+            default: m_row += c;
+            }
+        }
+    }
+    m_row += '\n';
+}
+
+template <typename T>
+static void appendBigEndian( QByteArray &buffer, T value )
+{
+    const T be = qToBigEndian<T>( value );
+    buffer.append( reinterpret_cast<const char*>( &be ), sizeof( T ) );
+}
+
+static void appendField( QByteArray &buffer, const QByteArray &data )
+{
+    appendBigEndian<qint32>( buffer, data.size() );
+    buffer += data;
+}
+
+void SqlCopyLoader::encodeBinary(const QVector<QVariant>& values)
+{
+    // microseconds/days since the PostgreSQL epoch 2000-01-01, assumes integer datetimes
+    static const qint64 PostgresEpochMSecs = Q_INT64_C( 946684800000 );
+
+    appendBigEndian<qint16>( m_row, values.size() );
+    foreach ( const QVariant &value, values ) {
+        if ( value.isNull() ) {
+            appendBigEndian<qint32>( m_row, -1 );
+            continue;
+        }
+        switch ( value.userType() ) {
+        case QMetaType::Bool:
+            appendBigEndian<qint32>( m_row, 1 );
+            m_row += value.toBool() ? '\1' : '\0';
+            break;
+        case QMetaType::Int:
+            appendBigEndian<qint32>( m_row, 4 );
+            appendBigEndian<qint32>( m_row, value.toInt() );
+            break;
+        case QMetaType::LongLong:
+            appendBigEndian<qint32>( m_row, 8 );
+            appendBigEndian<qint64>( m_row, value.toLongLong() );
+            break;
+        case QMetaType::Float: {
+            const float f = value.toFloat();
+            quint32 bits;
+            std::memcpy( &bits, &f, sizeof( bits ) );
+            appendBigEndian<qint32>( m_row, 4 );
+            appendBigEndian<quint32>( m_row, bits );
+            break;
+        }
+        case QMetaType::Double: {
+            const double d = value.toDouble();
+            quint64 bits;
+            std::memcpy( &bits, &d, sizeof( bits ) );
+            appendBigEndian<qint32>( m_row, 8 );
+            appendBigEndian<quint64>( m_row, bits );
+            break;
+        }
+        case QMetaType::QDateTime:
+            appendBigEndian<qint32>( m_row, 8 );
+            appendBigEndian<qint64>( m_row, ( value.toDateTime().toMSecsSinceEpoch() - PostgresEpochMSecs ) * 1000 );
+            break;
+        case QMetaType::QDate:
+            appendBigEndian<qint32>( m_row, 4 );
+            appendBigEndian<qint32>( m_row, QDate( 2000, 1, 1 ).daysTo( value.toDate() ) );
+            break;
+        case QMetaType::QTime:
+            appendBigEndian<qint32>( m_row, 8 );
+            appendBigEndian<qint64>( m_row, qint64( QTime( 0, 0 ).msecsTo( value.toTime() ) ) * 1000 );
+            break;
+        case QMetaType::QByteArray:
+            appendField( m_row, value.toByteArray() );
+            break;
+        default:
+            if ( value.userType() == qMetaTypeId<QUuid>() )
+                appendField( m_row, value.value<QUuid>().toRfc4122() );
+            else if ( value.userType() == qMetaTypeId<SqlNowType>() )
+                throw copyError( QLatin1String( "SqlNow can't be used with COPY" ) );
+            else
+                appendField( m_row, value.toString().toUtf8() );
+        }
+    }
+}
@@ -0,0 +1,242 @@
+/*
+    Copyright (C) 2013 Klarälvdalens Datakonsult AB,
+        a KDAB Group company, info@kdab.net,
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+#ifndef SQLCOPYLOADER_H
+#define SQLCOPYLOADER_H
+
+#include "sqlate_export.h"
+#include "SqlInsert.h"
+#include "SqlInternals_p.h"
+#include "SqlInsertQueryBuilder.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVector>
+
+#include <boost/mpl/assert.hpp>
+#include <boost/mpl/at.hpp>
+#include <boost/mpl/for_each.hpp>
+#include <boost/mpl/not.hpp>
+#include <boost/mpl/placeholders.hpp>
+#include <boost/mpl/size.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Bulk loader streaming rows into a table using PostgreSQL's COPY ... FROM STDIN.
+ * Rows are encoded into a buffer of bounded size, which is sent to the server whenever it is full,
+ * so client memory use does not depend on the number of rows loaded.
+ *
+ * COPY needs direct access to libpq, if sqlate was built without it or the connection does not use the
+ * QPSQL driver, rows are sent as multi-row INSERT statements instead (see SqlInsertQueryBuilder::addRow()),
+ * one batch per full buffer.
+ *
+ * In binary format, values need to have the QVariant type matching the SQL type of their column as
+ * created by SqlCreateTable, e.g. int for INTEGER columns. SqlNow is not supported, and as COPY has no
+ * notion of DEFAULT all columns need to be provided.
+ */
+class SQLATE_EXPORT SqlCopyLoader
+{
+public:
+    enum Format {
+        TextFormat,
+        BinaryFormat
+    };
+
+    /// Create a new loader for the given database
+    explicit SqlCopyLoader( const QSqlDatabase &db = QSqlDatabase::database() );
+    /// Aborts a COPY that was not finished, discarding its rows. Does not throw.
+    virtual ~SqlCopyLoader();
+
+    /// COPY @p tableName ...
+    void setTable( const QString &tableName );
+    template <typename Table>
+    void setTable( const Table & = Table() )
+    {
+        setTable( Table::sqlName() );
+    }
+
+    /// COPY table ( @p columnName, ... )
+    void addColumn( const QString &columnName );
+    template <typename Column>
+    void addColumn( const Column & )
+    {
+        addColumn( Column::sqlName() );
+    }
+
+    /// Sets the COPY format, the default is TextFormat. Has to be called before the first row is added.
+    void setFormat( Format format );
+
+    /// Sets the size of the client-side buffer in bytes, the default is 1 MiB.
+    void setBufferSize( int bytes );
+
+    /**
+     * Adds a row, @p values contains one value per column in the order the columns were added.
+     * The COPY is started with the first row.
+     * @throw SqlException if sending data to the server failed
+     */
+    void addRow( const QVector<QVariant> &values );
+
+    /**
+     * Adds a row, values are assigned to the columns by name. Columns not contained in @p values are NULL.
+     * @throw SqlException if sending data to the server failed
+     */
+    void addRow( const QList<Sql::ColumnValue> &values );
+
+    /**
+     * Sends the remaining rows and completes the COPY.
+     * elapsed() and rowsPerSecond() tell how long that took afterwards.
+     * @returns the number of rows loaded.
+     * @throw SqlException if the server rejected the data
+     */
+    qint64 finish();
+
+    /// Number of rows added so far.
+    qint64 rowCount() const { return m_rowCount; }
+
+    /// Milliseconds from the first row until finish(), or until now if not finished yet.
+    qint64 elapsed() const;
+
+    /// Loading throughput, in rows per second.
+    double rowsPerSecond() const;
+
+    /// Returns @c true if @p db supports COPY, otherwise multi-row INSERT statements are used.
+    static bool isCopySupported( const QSqlDatabase &db = QSqlDatabase::database() );
+
+private:
+    void start();
+    void startInsertBatch();
+    void flush();
+    void abort();
+    void encodeText( const QVector<QVariant> &values );
+    void encodeBinary( const QVector<QVariant> &values );
+
+    Q_DISABLE_COPY( SqlCopyLoader )
+
+    QSqlDatabase m_db;
+    QString m_table;
+    QStringList m_columns;
+    Format m_format;
+    int m_bufferSize;
+    QByteArray m_buffer;
+    QByteArray m_row; // the row being encoded, only appended to m_buffer when complete
+    int m_batchBytes; // estimated size of the pending INSERT batch, without COPY support
+    SqlInsertQueryBuilder *m_insert; // fallback without COPY support
+    void *m_connection; // PGconn, while a COPY is in progress
+    qint64 m_rowCount;
+    qint64 m_elapsed;
+    QElapsedTimer m_timer;
+    bool m_started;
+    bool m_finished;
+};
+
+namespace Sql {
+
+namespace detail {
+
+/**
+ * MPL for_each accumulator to add columns to the COPY loader.
+ * @internal
+ */
+template <typename Table>
+struct columns_to_copyloader
+{
+    explicit columns_to_copyloader( SqlCopyLoader &loader ) : m_loader( loader ) {}
+    template <typename C> void operator()( wrap<C> )
+    {
+        BOOST_MPL_ASSERT(( boost::is_same<typename C::table, Table> )); // only columns of the loaded table
+        m_loader.addColumn( C::sqlName() );
+    }
+
+    SqlCopyLoader &m_loader;
+};
+
+/**
+ * Converts a value loaded into @p Column.
+ * @internal
+ */
+template <typename Column, typename Value>
+QVariant copy_value( const Value &value )
+{
+    static_assert( std::is_convertible<Value, typename Column::type>::value, "value does not match the column type" );
+    return QVariant::fromValue<typename Column::type>( value );
+}
+
+template <typename Column>
+QVariant copy_value( SqlNullType )
+{
+    static_assert( !Column::notNull::value, "NULL loaded into a NOT NULL column" );
+    return QVariant();
+}
+
+}
+
+/**
+ * Typed COPY loader for a table defined with the TABLE macro.
+ * @code
+ * Sql::CopyLoader<PersonType, boost::mpl::vector<PersonType::PersonForenameType, PersonType::PersonSurnameType> > loader;
+ * loader.addRow( std::make_tuple( QString::fromLatin1( "Ford" ), QString::fromLatin1( "Prefect" ) ) );
+ * loader.finish();
+ * @endcode
+ * @tparam Table The table to load into.
+ * @tparam ColumnList A MPL sequence of the columns to load, all columns of @p Table by default.
+ */
+template <typename Table, typename ColumnList = typename Table::columns>
+class CopyLoader : public SqlCopyLoader
+{
+public:
+    explicit CopyLoader( const QSqlDatabase &db = QSqlDatabase::database() ) : SqlCopyLoader( db )
+    {
+        setTable<Table>();
+        boost::mpl::for_each<ColumnList, detail::wrap<boost::mpl::placeholders::_1> >( detail::columns_to_copyloader<Table>( *this ) );
+    }
+
+    using SqlCopyLoader::addRow;
+
+    /**
+     * Adds a row, with one value per column of @p ColumnList, type-checked against the column types.
+     * @throw SqlException if sending data to the server failed
+     */
+    template <typename... Values>
+    void addRow( const std::tuple<Values...> &row )
+    {
+        static_assert( sizeof...(Values) == boost::mpl::size<ColumnList>::value, "one value per column is needed" );
+        QVector<QVariant> values;
+        values.reserve( sizeof...(Values) );
+        appendValues( values, row, std::index_sequence_for<Values...>() );
+        SqlCopyLoader::addRow( values );
+    }
+
+private:
+    template <typename Tuple, std::size_t... I>
+    static void appendValues( QVector<QVariant> &values, const Tuple &row, std::index_sequence<I...> )
+    {
+        const int expand[] = { 0, ( values.push_back( detail::copy_value<typename boost::mpl::at_c<ColumnList, I>::type>( std::get<I>( row ) ) ), 0 )... };
+        Q_UNUSED( expand );
+    }
+};
+
+}
+
+#endif
@@ -201,6 +201,63 @@ struct column_trigger_creator
 };
 
 
+/**
+ * Creates the statements maintaining the ClosureTable of the recursive relation @p T:
+ * a trigger function adding and removing the paths through an inserted, deleted or updated row,
+ * the trigger calling it, and a fill of the closure table from the current content of @p T if it is empty.
+ * @internal
+ */
+template <typename T> QStringList closureTableStatements( boost::mpl::false_ ) { return QStringList(); }
+template <typename T> QStringList closureTableStatements( boost::mpl::true_ )
+{
+    typedef ClosureTable<T> C;
+    const QString left = T::leftType::sqlName();
+    const QString right = T::rightType::sqlName();
+    const QString name = C::sqlName() % QLatin1Literal( "_maintain" );
+
+    QStringList stmts;
+    stmts.push_back( QLatin1Literal( "DROP TRIGGER IF EXISTS " ) % name % QLatin1Literal( " on " ) % T::sqlName() );
+    // runs with the owner's rights as users cannot write the closure table, so nothing may be resolved
+    // through the caller's search_path: the closure table is qualified with the schema of the relation table
+    // the paths through a row are the ones from its left row or one below it to its right row or one above it
+    stmts.push_back( QString::fromLatin1(
+        "CREATE OR REPLACE FUNCTION %1() RETURNS trigger AS $$\n"
+        "DECLARE\n"
+        "  closure text := quote_ident(TG_TABLE_SCHEMA) || '.%2';\n"
+        "  paths text := 'SELECT d.node AS descendant, a.node AS ancestor, d.paths * a.paths AS paths FROM '\n"
+        "    || '(SELECT $1 AS node, 1 AS paths UNION ALL SELECT descendant, paths FROM ' || closure || ' WHERE ancestor = $1) AS d, '\n"
+        "    || '(SELECT $2 AS node, 1 AS paths UNION ALL SELECT ancestor, paths FROM ' || closure || ' WHERE descendant = $2) AS a';\n"
+        "  p RECORD;\n"
+        "BEGIN\n"
+        "  IF TG_OP <> 'INSERT' THEN\n"
+        "    FOR p IN EXECUTE paths USING OLD.%3, OLD.%4 LOOP\n"
+        "      EXECUTE 'UPDATE ' || closure || ' SET paths = paths - $3 WHERE descendant = $1 AND ancestor = $2' USING p.descendant, p.ancestor, p.paths;\n"
+        "      EXECUTE 'DELETE FROM ' || closure || ' WHERE descendant = $1 AND ancestor = $2 AND paths <= 0' USING p.descendant, p.ancestor;\n"
+        "    END LOOP;\n"
+        "  END IF;\n"
+        "  IF TG_OP <> 'DELETE' THEN\n"
+        "    FOR p IN EXECUTE paths USING NEW.%3, NEW.%4 LOOP\n"
+        "      EXECUTE 'INSERT INTO ' || closure || ' AS c (descendant, ancestor, paths) VALUES ($1, $2, $3) '\n"
+        "        || 'ON CONFLICT (descendant, ancestor) DO UPDATE SET paths = c.paths + EXCLUDED.paths' USING p.descendant, p.ancestor, p.paths;\n"
+        "    END LOOP;\n"
+        "  END IF;\n"
+        "  RETURN NULL;\n"
+        "END\n"
+        "$$ LANGUAGE plpgsql SECURITY DEFINER SET search_path = pg_catalog, pg_temp" )
+        .arg( name, C::sqlName(), left, right ) );
+    stmts.push_back( QLatin1Literal( "CREATE TRIGGER " ) % name % QLatin1Literal( " AFTER INSERT OR DELETE OR UPDATE OF " ) % left % QLatin1Literal( ", " ) % right
+                     % QLatin1Literal( " on " ) % T::sqlName() % QLatin1Literal( " FOR EACH ROW EXECUTE PROCEDURE " ) % name % QLatin1Literal( "()" ) );
+
+    // rows added before the trigger existed, i.e. when adding the closure table to an existing relation
+    stmts.push_back( QString::fromLatin1(
+        "WITH RECURSIVE sqlate_paths(descendant, ancestor) AS (SELECT %1, %2 FROM %3 "
+        "UNION ALL SELECT sqlate_paths.descendant, %3.%2 FROM sqlate_paths INNER JOIN %3 ON %3.%1 = sqlate_paths.ancestor) "
+        "INSERT INTO %4 (descendant, ancestor, paths) SELECT descendant, ancestor, COUNT(*) FROM sqlate_paths "
+        "WHERE NOT EXISTS (SELECT 1 FROM %4) GROUP BY descendant, ancestor" )
+        .arg( left, right, T::sqlName(), C::sqlName() ) );
+    return stmts;
+}
+
 /**
  * Helper class to create table creation statements.
  * @internal
@@ -285,6 +342,7 @@ QStringList createTableStatements()
 
 /**
  * Create the trigger statements for a single table.
+ * For recursive relations declared with CLOSURE_TABLE this includes the maintenance of the ClosureTable.
  */
 template <typename T>
 QStringList createTableTriggerStatements()
@@ -292,6 +350,7 @@ QStringList createTableTriggerStatements()
     QStringList triggers;
     detail::column_trigger_creator accu( triggers );
     boost::mpl::for_each<typename T::columns, detail::wrap<boost::mpl::placeholders::_1> >( accu );
+    triggers += detail::closureTableStatements<T>( typename T::has_closure_table() );
 
     return triggers;
 }
@@ -0,0 +1,93 @@
+/*
+    Copyright (C) 2013 Klarälvdalens Datakonsult AB,
+        a KDAB Group company, info@kdab.net,
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+#include "SqlCursor.h"
+
+#include "SqlSelectQueryBuilder.h"
+#include "SqlTransaction.h"
+
+#include <QAtomicInt>
+#include <QSqlQuery>
+
+static QAtomicInt s_cursorCounter;
+
+SqlCursor::SqlCursor(const SqlSelectQueryBuilder& qb, int batchSize) :
+    m_db( qb.m_db ),
+    m_transaction( new SqlTransaction( qb.m_db ) ),
+    m_query( qb.m_db ),
+    m_name( QLatin1String( "sqlate_cursor_" ) + QString::number( s_cursorCounter.fetchAndAddRelaxed( 1 ) ) ),
+    m_batchSize( qMax( 1, batchSize ) ),
+    m_rowCount( 0 ),
+    m_lastBatch( false )
+{
+    SqlSelectQueryBuilder builder( qb );
+    builder.statement(); // assemble, so the bound values are known
+    m_query.setForwardOnly( true );
+    m_query.exec( QLatin1String( "DECLARE " ) + m_name + QLatin1String( " NO SCROLL CURSOR FOR " ) + builder.inlinedStatement() );
+    fetch();
+}
+
+SqlCursor::~SqlCursor()
+{
+    if ( !m_transaction )
+        return;
+    // inside an outer transaction, rolling back ours is a no-op and would leave the cursor open
+    // until the outer transaction ends; QSqlQuery instead of SqlQuery as this must not throw
+    QSqlQuery closeQuery( m_db );
+    closeQuery.exec( QLatin1String( "CLOSE " ) + m_name );
+}
+
+void SqlCursor::setBatchSize(int batchSize)
+{
+    m_batchSize = qMax( 1, batchSize );
+}
+
+void SqlCursor::fetch()
+{
+    m_query.exec( QLatin1String( "FETCH FORWARD " ) + QString::number( m_batchSize ) + QLatin1String( " FROM " ) + m_name );
+    const int size = m_query.size();
+    // a short batch means the end was reached, saving the final empty round trip
+    m_lastBatch = size >= 0 && size < m_batchSize;
+}
+
+bool SqlCursor::next()
+{
+    if ( !m_transaction )
+        return false;
+    if ( m_query.next() ) {
+        ++m_rowCount;
+        return true;
+    }
+    if ( m_lastBatch )
+        return false;
+    fetch();
+    if ( !m_query.next() )
+        return false;
+    ++m_rowCount;
+    return true;
+}
+
+void SqlCursor::close()
+{
+    if ( !m_transaction )
+        return;
+    m_query.exec( QLatin1String( "CLOSE " ) + m_name );
+    m_transaction->commit();
+    m_transaction.reset();
+}
@@ -0,0 +1,103 @@
+/*
+    Copyright (C) 2013 Klarälvdalens Datakonsult AB,
+        a KDAB Group company, info@kdab.net,
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+#ifndef SQLCURSOR_H
+#define SQLCURSOR_H
+
+#include "sqlate_export.h"
+#include "SqlQuery.h"
+
+#include <QScopedPointer>
+#include <QSqlRecord>
+#include <QString>
+
+class SqlSelectQueryBuilder;
+class SqlTransaction;
+
+/**
+ * Streams the result of a SELECT query through a server-side cursor (DECLARE ... CURSOR / FETCH),
+ * fetching a batch of rows at a time. Unlike executing the query directly, which transfers the entire
+ * result set before the first row can be read, client memory use is bounded by the batch size.
+ *
+ * The cursor lives in a transaction, started by the constructor and ended by close() or the destructor,
+ * which nests into an already running SqlTransaction. Bound values are inlined into the DECLARE statement,
+ * as PostgreSQL can't prepare cursors.
+ *
+ * Usage, for both query builders and select expressions:
+ * @code
+ * SqlCursor cursor( select( Person.id ).from( Person ).orderBy( Person.id ) );
+ * while ( cursor.next() )
+ *     process( cursor.value( 0 ) );
+ * @endcode
+ */
+class SQLATE_EXPORT SqlCursor
+{
+public:
+    enum { DefaultBatchSize = 1000 };
+
+    /**
+     * Declares a cursor for the statement of @p qb.
+     * @throws SqlException if starting the transaction or declaring the cursor failed
+     */
+    explicit SqlCursor( const SqlSelectQueryBuilder &qb, int batchSize = DefaultBatchSize );
+
+    /// Closes the cursor and rolls back its transaction if close() hasn't been called. Does not throw.
+    ~SqlCursor();
+
+    /**
+     * Advances to the next row, fetching the next batch from the server if needed.
+     * @returns @c false if there are no more rows.
+     * @throws SqlException if fetching failed
+     */
+    bool next();
+
+    /// Returns the value of column @p index of the current row.
+    QVariant value( int index ) const { return m_query.value( index ); }
+
+    /// Returns the current row.
+    QSqlRecord record() const { return m_query.record(); }
+
+    /// Sets the number of rows fetched per round trip, takes effect with the next batch.
+    void setBatchSize( int batchSize );
+    int batchSize() const { return m_batchSize; }
+
+    /// Number of rows read with next() so far.
+    qint64 rowCount() const { return m_rowCount; }
+
+    /**
+     * Closes the cursor and ends its transaction.
+     * @throws SqlException on error
+     */
+    void close();
+
+private:
+    void fetch();
+
+    Q_DISABLE_COPY( SqlCursor )
+
+    QSqlDatabase m_db;
+    QScopedPointer<SqlTransaction> m_transaction;
+    SqlQuery m_query;
+    QString m_name;
+    int m_batchSize;
+    qint64 m_rowCount;
+    bool m_lastBatch;
+};
+
+#endif
@@ -57,6 +57,7 @@ struct DeleteExpr
     DeleteExpr( const DeleteExpr<OtherTableT, OtherWhereExprT> &other )
     {
         whereCondition = other.whereCondition;
+        returningColumns = other.returningColumns;
     }
 
     /**
@@ -83,6 +84,17 @@ struct DeleteExpr
         return s;
     }
 
+    /**
+     * Creates the RETURNING part of a DELETE statement, the deleted rows can be read from the executed query.
+     */
+    template <typename... ReturningColumns>
+    DeleteExpr<TableT, WhereExprT> returning( const ReturningColumns&... )
+    {
+        static_assert( detail::all_columns_of<TableT, ReturningColumns...>::value, "only columns of the table deleted from can be returned" );
+        returningColumns += detail::column_names<ReturningColumns...>();
+        return *this;
+    }
+
     /**
      * @internal
      * for unit testing access only
@@ -92,15 +104,55 @@ struct DeleteExpr
         SqlDeleteQueryBuilder qb;
         qb.setTable<TableT>();
         qb.whereCondition() = whereCondition;
+        foreach ( const QString &column, returningColumns )
+            qb.addReturningColumn( column );
         return qb;
     }
 
+    /**
+     * @internal
+     * Returns the statement text for this expression type, rendered once,
+     * or 0 if the text depends on more than the type (placeholder names, returned columns, number of IN values, sub-queries).
+     */
+    const detail::StaticStatement* staticStatement() const
+    {
+        typedef detail::static_statement<DeleteExpr, 1> Statements;
+        if ( whereCondition.hasPlaceholders() || whereCondition.hasSubQueries() || !returningColumns.isEmpty() )
+            return 0;
+        if ( whereCondition.hasValueLists() && !SqlQueryBuilderBase::supportsArrayBinding( QSqlDatabase::database() ) )
+            return 0;
+        const detail::StaticStatement *stmt = Statements::get( 0 );
+        if ( stmt )
+            return stmt;
+
+        detail::StaticStatement *rendered = new detail::StaticStatement;
+        rendered->text = queryBuilder().statement();
+        rendered->valueCount = bindValues().size();
+        return Statements::store( 0, rendered );
+    }
+
+    /**
+     * @internal
+     * Returns the values to bind, in the order of the placeholders in staticStatement().
+     */
+    QVector<QVariant> bindValues() const
+    {
+        QVector<QVariant> values;
+        whereCondition.collectBindValues( values );
+        return values;
+    }
+
     /**
      * Returns a prepared QSqlQuery ready for execution.
      */
     operator SqlQuery() const
     {
-        return queryBuilder().query();
+        const detail::StaticStatement *stmt = staticStatement();
+        if ( !stmt )
+            return queryBuilder().query();
+        const QVector<QVariant> values = bindValues();
+        Q_ASSERT( values.size() == stmt->valueCount );
+        return SqlQueryBuilderBase::prepareStatement( stmt->text, values );
     }
 
     /**
@@ -114,12 +166,13 @@ struct DeleteExpr
     }
 
     SqlCondition whereCondition;
+    QStringList returningColumns;
 };
 
 /**
  * Creates a DELETE statement. We can't use delete() as it is a reserved keyword.
  */
-DeleteExpr<detail::missing, detail::missing> del()
+inline DeleteExpr<detail::missing, detail::missing> del()
 {
     return DeleteExpr<detail::missing, detail::missing>();
 }
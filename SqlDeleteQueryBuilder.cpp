@@ -23,8 +23,6 @@
 
 #include "Sql.h"
 
-#include <QUuid>
-
 SqlDeleteQueryBuilder::SqlDeleteQueryBuilder(const QSqlDatabase& db) :
   SqlConditionalQueryBuilderBase( db ),
   m_includeSubTables( true )
@@ -36,38 +34,35 @@ void SqlDeleteQueryBuilder::setIncludeSubTables(bool includeSubTables)
     m_includeSubTables = includeSubTables;
 }
 
-SqlQuery& SqlDeleteQueryBuilder::query()
+void SqlDeleteQueryBuilder::assembleQuery()
 {
-    if ( !m_assembled ) {
-        QStringList cols;
-        m_queryString = QLatin1String( "DELETE FROM " );
-        if ( !m_includeSubTables ) {
-            m_queryString += QLatin1String( "ONLY " );
-        }
-        m_queryString += m_table;
-
-        m_bindValues.clear();
-        if ( m_whereCondition.hasSubConditions() ) {
-            m_queryString += QLatin1String( " WHERE " );
-            m_queryString += conditionToString( m_whereCondition );
-        }
+    m_queryString = QLatin1String( "DELETE FROM " );
+    if ( !m_includeSubTables ) {
+        m_queryString += QLatin1String( "ONLY " );
+    }
+    m_queryString += m_table;
 
-        m_queryString = m_queryString.trimmed();
-        m_assembled = true;
+    m_bindValues.clear();
+    if ( m_whereCondition.hasSubConditions() ) {
+        m_queryString += QLatin1String( " WHERE " );
+        m_queryString += conditionToString( m_whereCondition );
+    }
+    m_queryString += returningClause();
 
-#ifndef QUERYBUILDER_UNITTEST
-        m_query = prepareQuery( m_queryString );
+    m_queryString = m_queryString.trimmed();
+}
 
-        for ( int i = 0; i < m_bindValues.size(); ++i ) {
-            const QVariant value = m_bindValues.at( i );
-            // FIXME: similar code in the other query builders, we probably want that in the base class
-            if ( qstrcmp( value.typeName(), QMetaType::typeName( qMetaTypeId<QUuid>() ) ) == 0 )
-                m_query.bindValue( QLatin1Char( ':' ) + QString::number( i ), value.value<QUuid>().toString() ); // Qt SQL drivers don't handle QUuid
-            else
-                m_query.bindValue( QLatin1Char( ':' ) + QString::number( i ), value );
-        }
-#endif
-    }
-    return m_query;
+SqlQueryBuilderBase::Fingerprint SqlDeleteQueryBuilder::fingerprint() const
+{
+    Fingerprint fp;
+    fp << QLatin1String( "DELETE" ) << m_bindedValuesOffset << m_includeSubTables << m_table;
+    hashCondition( fp, m_whereCondition );
+    fp << m_returningColumns.join( QLatin1String( "," ) );
+    return fp;
 }
 
+void SqlDeleteQueryBuilder::collectBindValues()
+{
+    m_bindValues.clear();
+    m_whereCondition.collectBindValues( m_bindValues, valueListBinding() );
+}
@@ -40,11 +40,17 @@ public:
      */
     void setIncludeSubTables( bool includeSubTables  );
 
-    /// Returns the created query object, when called first, the query object is assembled and prepared
-    /// The method throws an SqlException if there is an error preparing the query.
-    SqlQuery& query();
+    /// Executes the statement once per entry of the given value arrays, see SqlQueryBuilderBase::execBatch().
+    using SqlQueryBuilderBase::execBatch;
+
+    /// ... RETURNING columnName, ..., see SqlQueryBuilderBase::addReturningColumn().
+    using SqlQueryBuilderBase::addReturningColumn;
 
 private:
+    /*reimp*/ void assembleQuery();
+    /*reimp*/ Fingerprint fingerprint() const;
+    /*reimp*/ void collectBindValues();
+
     friend class DeleteQueryBuilderTest;
     friend class DeleteTest;
     bool m_includeSubTables;
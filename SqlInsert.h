@@ -24,8 +24,16 @@
 #define SQL_INSERT_H
 
 #include "SqlInsertQueryBuilder.h"
+#include "SqlSchema_p.h"
 
 #include <boost/mpl/and.hpp>
+#include <boost/mpl/bool.hpp>
+#include <boost/mpl/contains.hpp>
+#include <boost/mpl/count_if.hpp>
+#include <boost/mpl/front.hpp>
+#include <boost/mpl/placeholders.hpp>
+#include <boost/mpl/size.hpp>
+#include <boost/mpl/vector.hpp>
 #include <boost/utility/enable_if.hpp>
 
 /**
@@ -41,14 +49,14 @@ struct ColumnValue
 {
     template <typename ColumnT>
     ColumnValue(const ColumnT&, const typename ColumnT::type& value) :
-        columnName(ColumnT::sqlName()), value(QVariant::fromValue( value )), isDefault(false)
+        columnName(ColumnT::sqlName()), tableName(ColumnT::table::sqlName()), value(QVariant::fromValue( value )), isDefault(false)
     {
         Sql::warning<boost::is_same<typename ColumnT::type, QDateTime>, UsageOfClientSideTime>::print();
     }
 
     template <typename ColumnT, class = typename boost::enable_if<typename ColumnT::is_column>::type>
     ColumnValue(const ColumnT&) :
-        columnName(ColumnT::sqlName()), isDefault(true)
+        columnName(ColumnT::sqlName()), tableName(ColumnT::table::sqlName()), isDefault(true)
     {
     }
 
@@ -58,6 +66,8 @@ struct ColumnValue
     }
 
     QString columnName;
+    /// SQL name of the table of the column, empty if only the column name is known
+    QString tableName;
     QVariant value;
     bool isDefault;
 
@@ -72,6 +82,33 @@ ColumnValue operator<<(const ColumnT& col, const typename ColumnT::type& value)
     return ColumnValue(col, value);
 }
 
+namespace detail {
+
+/** Checks if table constraint @p Constraint is a uniqueness constraint on exactly the columns @p ColList. */
+template <typename ColList, typename Constraint>
+struct is_unique_constraint_on : boost::mpl::false_ {};
+
+template <typename ColList, typename ConstraintCols>
+struct is_unique_constraint_on<ColList, UniqueConstraint<ConstraintCols> > : boost::mpl::bool_<
+    boost::mpl::size<ColList>::value == boost::mpl::size<ConstraintCols>::value &&
+    boost::mpl::count_if<ColList, boost::mpl::contains<ConstraintCols, boost::mpl::_1> >::value == boost::mpl::size<ColList>::value
+> {};
+
+/**
+ * Checks if the columns @p Columns can be used as ON CONFLICT target of table @p TableT, ie. if they all belong to
+ * that table and are a single unique or primary key column, or match one of the UniqueConstraint entries of the table.
+ */
+template <typename TableT, typename... Columns>
+struct is_conflict_target : boost::mpl::bool_<
+    all_columns_of<TableT, Columns...>::value && (
+        ( sizeof...(Columns) == 1 && boost::mpl::front<boost::mpl::vector<Columns...> >::type::unique::value ) ||
+        ( boost::mpl::count_if<typename TableT::constraints, is_unique_constraint_on<boost::mpl::vector<Columns...>, boost::mpl::_1> >::value > 0 ) )
+> {};
+
+}
+
+template <typename TableT> struct InsertConflictExpr;
+
 /**
  * Represents a INSERT statement
  * @internal
@@ -83,7 +120,7 @@ struct InsertExpr
     /**
      * Empty ctor.
      */
-    InsertExpr() : useDefaultValues(false) {}
+    InsertExpr() : useDefaultValues(false), conflictAction(SqlInsertQueryBuilder::NoConflictAction) {}
 
     /**
      * "Copy" ctor.
@@ -93,6 +130,10 @@ struct InsertExpr
     InsertExpr( const InsertExpr<OtherTableT> &other )
     {
         values = other.values;
+        rows = other.rows;
+        useDefaultValues = other.useDefaultValues;
+        returningColumns = other.returningColumns;
+        conflictAction = SqlInsertQueryBuilder::NoConflictAction;
     }
 
     /**
@@ -125,6 +166,51 @@ struct InsertExpr
         return *this;
     }
 
+    /**
+     * Adds a row for a multi-row INSERT. All rows need to provide values for the same columns in the same order,
+     * and can't be combined with columns().
+     */
+    InsertExpr<TableT> row( const QList<ColumnValue>& cols )
+    {
+        Q_ASSERT( values.isEmpty() );
+        Q_ASSERT( rows.isEmpty() || rows.first().size() == cols.size() );
+        rows.push_back( cols.toVector() );
+        return *this;
+    }
+    InsertExpr<TableT> row( const ColumnValue& col )
+    {
+        return row(QList<ColumnValue>() << col);
+    }
+
+    /**
+     * Creates the ON CONFLICT part of an INSERT statement, followed by doNothing() or doUpdate().
+     * The conflict target columns have to be a unique or primary key column, or match a UniqueConstraint of the table.
+     */
+    template <typename... ConflictColumns>
+    InsertConflictExpr<TableT> onConflict( const ConflictColumns&... )
+    {
+        static_assert( sizeof...(ConflictColumns) > 0, "at least one conflict target column is needed" );
+        static_assert( detail::all_columns_of<TableT, ConflictColumns...>::value, "conflict target columns must belong to the inserted table" );
+        static_assert( detail::is_conflict_target<TableT, ConflictColumns...>::value,
+                       "conflict target columns are not covered by a unique index" );
+        Q_ASSERT( conflictAction == SqlInsertQueryBuilder::NoConflictAction ); // only one onConflict allowed
+        InsertConflictExpr<TableT> expr;
+        expr.insert = *this;
+        expr.columns = detail::column_names<ConflictColumns...>();
+        return expr;
+    }
+
+    /**
+     * Creates the RETURNING part of an INSERT statement, the returned rows can be read from the executed query.
+     */
+    template <typename... ReturningColumns>
+    InsertExpr<TableT> returning( const ReturningColumns&... )
+    {
+        static_assert( detail::all_columns_of<TableT, ReturningColumns...>::value, "only columns of the inserted table can be returned" );
+        returningColumns += detail::column_names<ReturningColumns...>();
+        return *this;
+    }
+
     /**
      * @internal
      * for unit testing access only
@@ -133,7 +219,20 @@ struct InsertExpr
     {
         SqlInsertQueryBuilder qb;
         qb.setTable<TableT>();
-        if (values.isEmpty() || useDefaultValues) {
+        if (!rows.isEmpty()) {
+            foreach (const ColumnValue& col, rows.first()) {
+                qb.addColumn(col.columnName);
+            }
+            foreach (const QVector<ColumnValue>& r, rows) {
+                QVector<QVariant> rowValues;
+                rowValues.reserve(r.size());
+                for (int i = 0; i < r.size(); ++i) {
+                    Q_ASSERT(r.at(i).columnName == rows.first().at(i).columnName);
+                    rowValues.push_back(r.at(i).value);
+                }
+                qb.addRow(rowValues);
+            }
+        } else if (values.isEmpty() || useDefaultValues) {
             foreach (const ColumnValue& column, values) {
                 qb.addColumn(column.columnName);
             }
@@ -147,6 +246,19 @@ struct InsertExpr
                 }
             }
         }
+        foreach (const QString& column, returningColumns) {
+            qb.addReturningColumn(column);
+        }
+        if (conflictAction != SqlInsertQueryBuilder::NoConflictAction) {
+            qb.setOnConflict(conflictColumns, conflictAction);
+            foreach (const ColumnValue& col, conflictUpdates) {
+                if (col.isDefault) {
+                    qb.addConflictUpdateColumn(col.columnName);
+                } else {
+                    qb.addConflictUpdateColumnValue(col.columnName, col.value);
+                }
+            }
+        }
         return qb;
     }
 
@@ -169,22 +281,80 @@ struct InsertExpr
     }
 
     QVector<ColumnValue> values;
+    QVector<QVector<ColumnValue> > rows;
     bool useDefaultValues;
+    QStringList conflictColumns;
+    SqlInsertQueryBuilder::ConflictAction conflictAction;
+    QVector<ColumnValue> conflictUpdates;
+    QStringList returningColumns;
+};
+
+/**
+ * Represents the ON CONFLICT part of an INSERT statement, before the conflict action is known.
+ * @internal
+ * @tparam TableT The table type inserted into.
+ */
+template <typename TableT>
+struct InsertConflictExpr
+{
+    /** ON CONFLICT ( ... ) DO NOTHING */
+    InsertExpr<TableT> doNothing() const
+    {
+        InsertExpr<TableT> expr( insert );
+        expr.conflictColumns = columns;
+        expr.conflictAction = SqlInsertQueryBuilder::ConflictDoNothing;
+        return expr;
+    }
+
+    /**
+     * ON CONFLICT ( ... ) DO UPDATE SET ...
+     * Columns given without a value are set to the value proposed for insertion (EXCLUDED.column).
+     */
+    InsertExpr<TableT> doUpdate( const QList<ColumnValue>& cols ) const
+    {
+        Q_ASSERT( !cols.isEmpty() );
+        foreach ( const ColumnValue &col, cols )
+            Q_ASSERT( col.tableName.isEmpty() || col.tableName == TableT::sqlName() ); // only columns of the inserted table can be updated
+        InsertExpr<TableT> expr( insert );
+        expr.conflictColumns = columns;
+        expr.conflictAction = SqlInsertQueryBuilder::ConflictDoUpdate;
+        expr.conflictUpdates = cols.toVector();
+        return expr;
+    }
+    InsertExpr<TableT> doUpdate( const ColumnValue& col ) const
+    {
+        return doUpdate(QList<ColumnValue>() << col);
+    }
+
+    /** ON CONFLICT ( ... ) DO UPDATE SET column = EXCLUDED.column, ... for each of the given columns. */
+    template <typename UpdateColumn, typename... UpdateColumns>
+    typename boost::enable_if<typename UpdateColumn::is_column, InsertExpr<TableT> >::type
+    doUpdate( const UpdateColumn&, const UpdateColumns&... ) const
+    {
+        static_assert( detail::all_columns_of<TableT, UpdateColumn, UpdateColumns...>::value, "only columns of the inserted table can be updated" );
+        QList<ColumnValue> cols;
+        foreach ( const QString &column, (detail::column_names<UpdateColumn, UpdateColumns...>()) )
+            cols.push_back( ColumnValue( column ) );
+        return doUpdate( cols );
+    }
+
+    InsertExpr<TableT> insert;
+    QStringList columns;
 };
 
 /**
  * Creates a INSERT statement.
  */
-InsertExpr<detail::missing> insert()
+inline InsertExpr<detail::missing> insert()
 {
     return InsertExpr<detail::missing>();
 }
 
-QList<ColumnValue> operator&(const ColumnValue& c1, const ColumnValue& c2)
+inline QList<ColumnValue> operator&(const ColumnValue& c1, const ColumnValue& c2)
 {
     return QList<ColumnValue>() << c1 << c2;
 }
-QList<ColumnValue> operator&(const QList<ColumnValue>& c1, const ColumnValue& c2)
+inline QList<ColumnValue> operator&(const QList<ColumnValue>& c1, const ColumnValue& c2)
 {
     return QList<ColumnValue>() << c1 << c2;
 }
@@ -22,10 +22,12 @@
 #include "SqlInsertQueryBuilder.h"
 
 #include "SqlExceptions.h"
+#include "SqlTransaction.h"
 #include "Sql.h"
 
 SqlInsertQueryBuilder::SqlInsertQueryBuilder(const QSqlDatabase& db) :
-  SqlQueryBuilderBase( db )
+  SqlQueryBuilderBase( db ),
+  m_conflictAction( NoConflictAction )
 {
 }
 
@@ -45,62 +47,203 @@ void SqlInsertQueryBuilder::setToDefaultValues()
     m_values.clear();
 }
 
+void SqlInsertQueryBuilder::addRow(const QVector<QVariant>& values)
+{
+    Q_ASSERT( m_values.isEmpty() );
+    Q_ASSERT( values.size() == m_columnNames.size() );
+    m_rows.push_back( values );
+}
 
-SqlQuery& SqlInsertQueryBuilder::query()
+void SqlInsertQueryBuilder::setOnConflict(const QStringList& conflictColumns, SqlInsertQueryBuilder::ConflictAction action)
 {
-    if ( !m_assembled ) {
-
-        m_queryString = QLatin1String( "INSERT INTO " );
-        m_queryString += m_table;
-
-#ifndef QUERYBUILDER_UNITTEST
-        bool bindValues = false;
-#endif
-
-        if ( m_columnNames.isEmpty() ) { // no columns = all default
-            m_queryString += QLatin1String(" DEFAULT VALUES");
-        } else {
-            if ( !m_columnNames.isEmpty() ) { //columns specified
-                m_queryString += QLatin1String( " (" );
-                Q_FOREACH( const QString& column, m_columnNames ) {
-                    m_queryString += column + QLatin1String( "," );
-                }
-                m_queryString[ m_queryString.length() -1 ] = QLatin1Char(')');
-            }
-            m_queryString += QLatin1String( " VALUES (" );
-            int index = 0;
-            foreach (const QString& column, m_columnNames) {
-                if (m_values.contains(column)) {
-                    const QVariant value = m_values[column];
-                    if (value.userType() == qMetaTypeId<SqlNowType>()) {
-                        m_queryString += currentDateTime() % QLatin1Char(',');
-                    } else {
-                        m_queryString += QString::fromLatin1( ":%1," ).arg(index);
-                    }
-                } else {
-                    m_queryString += QLatin1String( "DEFAULT," );
-                }
-                ++index;
-            }
-            m_queryString[ m_queryString.length() -1 ] = QLatin1Char(')');
-#ifndef QUERYBUILDER_UNITTEST
-            bindValues = true;
-#endif
+    Q_ASSERT( action != ConflictDoUpdate || !conflictColumns.isEmpty() );
+    m_conflictColumns = conflictColumns;
+    m_conflictAction = action;
+}
+
+void SqlInsertQueryBuilder::addConflictUpdateColumnValue(const QString& columnName, const QVariant& value)
+{
+    ConflictUpdate update;
+    update.columnName = columnName;
+    update.value = value;
+    update.excluded = false;
+    m_conflictUpdates.push_back( update );
+}
+
+void SqlInsertQueryBuilder::addConflictUpdateColumn(const QString& columnName)
+{
+    ConflictUpdate update;
+    update.columnName = columnName;
+    update.excluded = true;
+    m_conflictUpdates.push_back( update );
+}
+
+int SqlInsertQueryBuilder::maxRowsPerStatement() const
+{
+    // PostgreSQL uses 16 bit parameter numbers, also keep individual statements reasonably small
+    static const int MaxBindValues = 32767;
+    static const int MaxRows = 1024;
+    return qBound( 1, ( MaxBindValues - m_conflictUpdates.size() ) / qMax( 1, m_columnNames.size() ), MaxRows );
+}
+
+QString SqlInsertQueryBuilder::conflictClause(int firstPlaceholder) const
+{
+    if ( m_conflictAction == NoConflictAction )
+        return QString();
+
+    QString clause = QLatin1String( " ON CONFLICT" );
+    if ( !m_conflictColumns.isEmpty() )
+        clause += QLatin1String( " (" ) % m_conflictColumns.join( QLatin1String( "," ) ) % QLatin1Char( ')' );
+    if ( m_conflictAction == ConflictDoNothing ) {
+        clause += QLatin1String( " DO NOTHING" );
+        return clause;
+    }
+
+    Q_ASSERT( !m_conflictUpdates.isEmpty() );
+    clause += QLatin1String( " DO UPDATE SET " );
+    for ( int i = 0; i < m_conflictUpdates.size(); ++i ) {
+        const ConflictUpdate &update = m_conflictUpdates.at( i );
+        if ( i > 0 )
+            clause += QLatin1String( ", " );
+        clause += update.columnName % QLatin1String( " = " );
+        if ( update.excluded )
+            clause += QLatin1String( "EXCLUDED." ) % update.columnName;
+        else if ( update.value.userType() == qMetaTypeId<SqlNowType>() )
+            clause += currentDateTime();
+        else
+            clause += QLatin1Char( ':' ) + QString::number( firstPlaceholder + i );
+    }
+    return clause;
+}
+
+void SqlInsertQueryBuilder::bindConflictValues(int firstPlaceholder)
+{
+    if ( m_conflictAction != ConflictDoUpdate )
+        return;
+    // keep in sync with conflictClause()
+    for ( int i = 0; i < m_conflictUpdates.size(); ++i ) {
+        const ConflictUpdate &update = m_conflictUpdates.at( i );
+        if ( !update.excluded && update.value.userType() != qMetaTypeId<SqlNowType>() )
+            bindValue( firstPlaceholder + i, update.value );
+    }
+}
+
+QString SqlInsertQueryBuilder::rowsStatement(int rows) const
+{
+    QString stmt = QLatin1String( "INSERT INTO " ) % m_table % QLatin1String( " (" ) % m_columnNames.join( QLatin1String( "," ) ) % QLatin1String( ") VALUES " );
+    int index = 0;
+    for ( int row = 0; row < rows; ++row ) {
+        stmt += row == 0 ? QLatin1String( "(" ) : QLatin1String( ",(" );
+        for ( int column = 0; column < m_columnNames.size(); ++column ) {
+            if ( column > 0 )
+                stmt += QLatin1Char( ',' );
+            stmt += QLatin1Char( ':' ) + QString::number( index++ );
         }
+        stmt += QLatin1Char( ')' );
+    }
+    stmt += conflictClause( index );
+    stmt += returningClause();
+    return stmt;
+}
 
-        m_assembled = true;
+void SqlInsertQueryBuilder::exec()
+{
+    if ( m_rows.isEmpty() ) {
+        SqlQueryBuilderBase::exec();
+        return;
+    }
 
-#ifndef QUERYBUILDER_UNITTEST
-        m_query = prepareQuery( m_queryString );
+    const int maxRows = maxRowsPerStatement();
+    SqlTransaction transaction( m_db );
+    int row = 0;
+    while ( row < m_rows.size() ) {
+        int chunk = maxRows;
+        const int remaining = m_rows.size() - row;
+        if ( remaining < maxRows ) {
+            // largest power of two that fits
+            chunk = 1;
+            while ( chunk * 2 <= remaining )
+                chunk *= 2;
+        }
 
-        if ( bindValues ) {
-            for ( int i = 0; i < m_values.size(); ++i ) {
-                const QVariant value = m_values.values().at( i );
-                bindValue( i, value );
+        m_query = prepareQuery( rowsStatement( chunk ) );
+        int index = 0;
+        for ( int i = row; i < row + chunk; ++i ) {
+            foreach ( const QVariant &value, m_rows.at( i ) ) {
+                Q_ASSERT( value.userType() != qMetaTypeId<SqlNowType>() );
+                bindValue( index++, value );
             }
         }
-#endif
+        bindConflictValues( index );
+        m_query.exec();
+        row += chunk;
     }
-    return m_query;
+    transaction.commit();
 }
 
+
+void SqlInsertQueryBuilder::assembleQuery()
+{
+    m_queryString = QLatin1String( "INSERT INTO " );
+    m_queryString += m_table;
+
+    if ( !m_rows.isEmpty() ) {
+        // only exec() splits rows into chunks, a single statement must stay within the bind value limit
+        if ( m_rows.size() > maxRowsPerStatement() ) {
+            throw SqlException( QSqlError( QString::fromLatin1( "%1 rows exceed the limit of %2 rows per statement, use exec()" ).arg( m_rows.size() ).arg( maxRowsPerStatement() ),
+                                           QString(), QSqlError::StatementError ) );
+        }
+        m_queryString = rowsStatement( m_rows.size() );
+    } else if ( m_columnNames.isEmpty() ) { // no columns = all default
+        m_queryString += QLatin1String(" DEFAULT VALUES");
+    } else {
+        if ( !m_columnNames.isEmpty() ) { //columns specified
+            m_queryString += QLatin1String( " (" );
+            Q_FOREACH( const QString& column, m_columnNames ) {
+                m_queryString += column + QLatin1String( "," );
+            }
+            m_queryString[ m_queryString.length() -1 ] = QLatin1Char(')');
+        }
+        m_queryString += QLatin1String( " VALUES (" );
+        int index = 0;
+        foreach (const QString& column, m_columnNames) {
+            if (m_values.contains(column)) {
+                const QVariant value = m_values[column];
+                if (value.userType() == qMetaTypeId<SqlNowType>()) {
+                    m_queryString += currentDateTime() % QLatin1Char(',');
+                } else {
+                    m_queryString += QString::fromLatin1( ":%1," ).arg(index);
+                }
+            } else {
+                m_queryString += QLatin1String( "DEFAULT," );
+            }
+            ++index;
+        }
+        m_queryString[ m_queryString.length() -1 ] = QLatin1Char(')');
+    }
+    if ( m_rows.isEmpty() ) {
+        m_queryString += conflictClause( m_columnNames.size() );
+        m_queryString += returningClause();
+    }
+}
+
+void SqlInsertQueryBuilder::bindQueryValues()
+{
+    if ( !m_rows.isEmpty() ) {
+        int index = 0;
+        foreach ( const QVector<QVariant> &row, m_rows ) {
+            foreach ( const QVariant &value, row )
+                bindValue( index++, value );
+        }
+        bindConflictValues( index );
+        return;
+    }
+
+    // placeholders are numbered by column position, see assembleQuery()
+    for ( int i = 0; i < m_columnNames.size(); ++i ) {
+        const QMap<QString, QVariant>::const_iterator it = m_values.constFind( m_columnNames.at( i ) );
+        if ( it != m_values.constEnd() )
+            bindValue( i, it.value() );
+    }
+    bindConflictValues( m_columnNames.size() );
+}
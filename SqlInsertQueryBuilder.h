@@ -28,6 +28,7 @@
 
 #include <QDateTime>
 #include <QStringList>
+#include <QVector>
 
 #include <boost/mpl/assert.hpp>
 #include <boost/mpl/not.hpp>
@@ -77,15 +78,109 @@ public:
     /// INSERT INTO ... DEFAULT VALUES
     void setToDefaultValues();
 
-    /// Returns the created query object, when called first, the query object is assembled and prepared
-    SqlQuery& query();
+    /**
+     * Adds a row for a multi-row INSERT INTO table ( ... ) VALUES ( ... ), ( ... ), ...
+     * @p values contains one value per column, in the order the columns were added with addColumn().
+     * Rows can't be combined with addColumnValue(), and SqlNow is not supported as a row value.
+     */
+    void addRow( const QVector<QVariant> &values );
+
+    /// Returns the number of rows added with addRow().
+    int rowCount() const { return m_rows.size(); }
+
+    /**
+     * Executes the query. Rows added with addRow() are sent in chunks of multi-row statements inside
+     * a single transaction, see maxRowsPerStatement(). In that case query() only holds the rows returned
+     * by the last chunk, see addReturningColumn(). The method throws an SqlException on error.
+     * @note All other ways of rendering the statement, e.g. query(), statement(), execBatch() or
+     * SqlQueryWarmup::registerBuilder(), use a single statement for all rows, and throw an SqlException
+     * if there are more than maxRowsPerStatement() rows.
+     */
+    /*reimp*/ void exec();
+
+    /**
+     * Returns the maximum number of rows sent per statement by exec(), derived from the limit of bind values
+     * per statement. Smaller remainders are split into power of two sized chunks, so that only a few distinct
+     * statements end up in the query cache.
+     */
+    int maxRowsPerStatement() const;
+
+    /// Conflict handling of INSERT ... ON CONFLICT, see setOnConflict().
+    enum ConflictAction {
+        NoConflictAction, ///< no ON CONFLICT clause, conflicts raise an error
+        ConflictDoNothing, ///< ON CONFLICT ... DO NOTHING
+        ConflictDoUpdate ///< ON CONFLICT ... DO UPDATE SET ..., see addConflictUpdateColumnValue()
+    };
+
+    /**
+     * INSERT ... ON CONFLICT ( @p conflictColumns ) DO NOTHING / DO UPDATE
+     * @p conflictColumns need to match a unique index or constraint of the table, they can only be empty for DO NOTHING.
+     */
+    void setOnConflict( const QStringList &conflictColumns, ConflictAction action );
+
+    /// ... ON CONFLICT ( ... ) DO UPDATE SET @p columnName = @p value
+    void addConflictUpdateColumnValue( const QString &columnName, const QVariant &value );
+
+    /// ... ON CONFLICT ( ... ) DO UPDATE SET @p columnName = EXCLUDED.@p columnName, ie. the value proposed for insertion
+    void addConflictUpdateColumn( const QString &columnName );
+
+    template <typename Column>
+    void addConflictUpdateColumnValue( const Column &, const typename Column::type &value )
+    {
+        Sql::warning<boost::is_same<typename Column::type, QDateTime>, UsageOfClientSideTime>::print();
+        addConflictUpdateColumnValue( Column::sqlName(), QVariant::fromValue( value ) );
+    }
+    template <typename Column>
+    void addConflictUpdateColumnValue( const Column &, SqlNullType )
+    {
+        BOOST_MPL_ASSERT(( boost::mpl::not_<typename Column::notNull> ));
+        addConflictUpdateColumnValue( Column::sqlName(), QVariant() );
+    }
+    template <typename Column>
+    void addConflictUpdateColumnValue( const Column &, SqlNowType now )
+    {
+        BOOST_MPL_ASSERT(( boost::is_same<typename Column::type, QDateTime> ));
+        addConflictUpdateColumnValue( Column::sqlName(), QVariant::fromValue(now) );
+    }
+    template <typename Column>
+    void addConflictUpdateColumn( const Column & )
+    {
+        addConflictUpdateColumn( Column::sqlName() );
+    }
+
+    /// Executes the statement once per entry of the given value arrays, see SqlQueryBuilderBase::execBatch().
+    using SqlQueryBuilderBase::execBatch;
+
+    /// ... RETURNING columnName, ..., see SqlQueryBuilderBase::addReturningColumn().
+    using SqlQueryBuilderBase::addReturningColumn;
+
+private:
+    /*reimp*/ void assembleQuery();
+    /*reimp*/ void bindQueryValues();
+
+    /** Returns the statement inserting @p rows rows. */
+    QString rowsStatement( int rows ) const;
+    /** Returns the ON CONFLICT clause, its placeholders are numbered from @p firstPlaceholder. */
+    QString conflictClause( int firstPlaceholder ) const;
+    /** Binds the values of the DO UPDATE part, see conflictClause(). */
+    void bindConflictValues( int firstPlaceholder );
 
-private:      
     friend class InsertQueryBuilderTest;
     friend class InsertTest;
     
     QStringList m_columnNames; //holds the column names, used for unit testing
     QMap<QString, QVariant> m_values; //holds the inserted values, used for unit testing
+    QVector<QVector<QVariant> > m_rows;
+
+    struct ConflictUpdate
+    {
+        QString columnName;
+        QVariant value;
+        bool excluded;
+    };
+    QStringList m_conflictColumns;
+    QVector<ConflictUpdate> m_conflictUpdates;
+    ConflictAction m_conflictAction;
 };
 
 #endif
@@ -21,9 +21,15 @@
 #ifndef SQLINTERNALS_P_H
 #define SQLINTERNALS_P_H
 
+#include <QAtomicPointer>
+#include <QString>
+#include <QStringList>
+
+#include <boost/mpl/bool.hpp>
 #include <boost/mpl/fold.hpp>
 #include <boost/mpl/placeholders.hpp>
 #include <boost/mpl/push_back.hpp>
+#include <boost/type_traits/is_same.hpp>
 
 /**
  * @file SqlInternals_p.h
@@ -44,6 +50,77 @@ template <typename T> struct wrap {};
 /** Empty type for eg. not yet specified parts of a query. */
 struct missing {};
 
+/**
+ * Statement text rendered once for an expression type.
+ * @internal
+ */
+struct StaticStatement {
+    QString text;
+    int valueCount; ///< number of values to bind, for sanity checking
+};
+
+/**
+ * Lock-free per-type storage for statements rendered by the expression templates.
+ * Slots are filled on first use and live until the process exits, a lost race merely renders a statement twice.
+ * @tparam Expr The expression type the statements belong to.
+ * @tparam Variants The number of different statements an expression type can produce, e.g. due to runtime sort orders.
+ * @internal
+ */
+template <typename Expr, int Variants>
+struct static_statement
+{
+    static const StaticStatement* get( int variant )
+    {
+        Q_ASSERT( variant >= 0 && variant < Variants );
+        return slots()[variant].loadAcquire();
+    }
+
+    /** Publishes @p rendered for @p variant, and returns whatever statement won the race. */
+    static const StaticStatement* store( int variant, StaticStatement *rendered )
+    {
+        Q_ASSERT( variant >= 0 && variant < Variants );
+        if ( slots()[variant].testAndSetOrdered( 0, rendered ) )
+            return rendered;
+        delete rendered;
+        return slots()[variant].loadAcquire();
+    }
+
+private:
+    static QBasicAtomicPointer<StaticStatement>* slots()
+    {
+        // zero-initialized POD, so no initialization guard needed
+        static QBasicAtomicPointer<StaticStatement> s_slots[Variants];
+        return s_slots;
+    }
+};
+
+/**
+ * Checks if all @p Columns belong to table @p TableT.
+ * @internal
+ */
+template <typename TableT, typename... Columns>
+struct all_columns_of : boost::mpl::true_ {};
+
+template <typename TableT, typename Column, typename... Columns>
+struct all_columns_of<TableT, Column, Columns...> : boost::mpl::bool_<
+    boost::is_same<typename Column::table, TableT>::value && all_columns_of<TableT, Columns...>::value
+> {};
+
+/**
+ * Returns the SQL names of @p Columns, in order.
+ * @internal
+ */
+template <typename... Columns>
+QStringList column_names()
+{
+    const QString names[] = { QString(), Columns::sqlName()... };
+    QStringList list;
+    list.reserve( sizeof...(Columns) );
+    for ( std::size_t i = 1; i <= sizeof...(Columns); ++i )
+        list.push_back( names[i] );
+    return list;
+}
+
 }
 
 /**
@@ -0,0 +1,263 @@
+/*
+    Copyright (C) 2013 Klarälvdalens Datakonsult AB,
+        a KDAB Group company, info@kdab.net,
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+#ifndef SQL_PREPARE_H
+#define SQL_PREPARE_H
+
+#include "SqlCondition.h"
+#include "SqlExceptions.h"
+#include "SqlInternals_p.h"
+#include "SqlQuery.h"
+#include "SqlQueryBuilderBase.h"
+#include "SqlSelectQueryBuilder.h"
+
+#include <QSqlError>
+#include <QStringList>
+#include <QVector>
+
+#include <boost/mpl/at.hpp>
+#include <boost/mpl/count_if.hpp>
+#include <boost/mpl/fold.hpp>
+#include <boost/mpl/placeholders.hpp>
+#include <boost/mpl/push_back.hpp>
+#include <boost/mpl/size.hpp>
+#include <boost/mpl/vector.hpp>
+
+#include <type_traits>
+
+/**
+ * @file SqlPrepare.h
+ * Typed handles for statements prepared once and executed many times.
+ */
+
+namespace Sql {
+
+template <typename ColumnList, typename TableT, typename JoinList, typename WhereExprT, typename GroupByList, typename SortList> struct SelectExpr;
+template <typename TableT, typename WhereExprT> struct DeleteExpr;
+template <typename TableT, typename JoinCond> struct JoinExpr;
+
+namespace detail {
+
+/**
+ * Metafunction checking if a condition, a JOIN or a sub-query contains placeholders.
+ * @internal
+ */
+template <typename T>
+struct has_placeholders : boost::mpl::false_ {};
+
+template <typename Lhs, SqlCondition::CompareOperator Comp, typename Rhs>
+struct has_placeholders<ConditionPlaceholderLeaf<Lhs, Comp, Rhs> > : boost::mpl::true_ {};
+
+template <typename SubConditionList, SqlCondition::LogicOperator Op>
+struct has_placeholders<ConditionExpr<SubConditionList, Op> >
+    : boost::mpl::bool_<boost::mpl::count_if<SubConditionList, has_placeholders<boost::mpl::placeholders::_1> >::value != 0>
+{};
+
+template <typename Lhs, SqlCondition::CompareOperator Comp, typename Rhs>
+struct has_placeholders<ConditionSubQueryLeaf<Lhs, Comp, Rhs> > : has_placeholders<Rhs> {};
+
+template <typename TableT, typename JoinCond>
+struct has_placeholders<JoinExpr<TableT, JoinCond> > : has_placeholders<JoinCond> {};
+
+template <typename ColumnList, typename TableT, typename JoinList, typename WhereExprT, typename GroupByList, typename SortList>
+struct has_placeholders<SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> >
+    : boost::mpl::bool_<has_placeholders<WhereExprT>::value || boost::mpl::count_if<JoinList, has_placeholders<boost::mpl::placeholders::_1> >::value != 0>
+{};
+
+/**
+ * MPL fold operation adding the column of a placeholder condition to a sequence of columns.
+ * @internal
+ */
+template <typename Columns, typename Leaf>
+struct append_placeholder_column
+{
+    typedef Columns type;
+};
+
+template <typename Columns, typename Lhs, SqlCondition::CompareOperator Comp, typename Rhs>
+struct append_placeholder_column<Columns, ConditionPlaceholderLeaf<Lhs, Comp, Rhs> >
+{
+    typedef typename boost::mpl::push_back<Columns, Lhs>::type type;
+};
+
+/// sub-queries are bound by the outer statement, which only sees the placeholders of its own WHERE condition
+template <typename Columns, typename Lhs, SqlCondition::CompareOperator Comp, typename Rhs>
+struct append_placeholder_column<Columns, ConditionSubQueryLeaf<Lhs, Comp, Rhs> >
+{
+    static_assert( !has_placeholders<Rhs>::value, "placeholders in sub-queries are not supported by prepare()" );
+    typedef Columns type;
+};
+
+/// nested expressions contribute their placeholders in place
+template <typename Columns, typename SubConditionList, SqlCondition::LogicOperator Op>
+struct append_placeholder_column<Columns, ConditionExpr<SubConditionList, Op> >
+    : boost::mpl::fold<SubConditionList, Columns, append_placeholder_column<boost::mpl::placeholders::_1, boost::mpl::placeholders::_2> >
+{};
+
+/**
+ * Metafunction returning the columns compared to placeholders in a WHERE expression, in order of appearance.
+ * @internal
+ */
+template <typename WhereExprT>
+struct placeholder_columns
+{
+    typedef boost::mpl::vector<> type;
+};
+
+template <typename SubConditionList, SqlCondition::LogicOperator Op>
+struct placeholder_columns<ConditionExpr<SubConditionList, Op> >
+    : boost::mpl::fold<SubConditionList, boost::mpl::vector<>, append_placeholder_column<boost::mpl::placeholders::_1, boost::mpl::placeholders::_2> >
+{};
+
+/**
+ * Converts a value for a placeholder compared to @p Column.
+ * @internal
+ */
+template <typename Column, typename Value>
+QVariant placeholder_value( const Value &value )
+{
+    static_assert( std::is_convertible<Value, typename Column::type>::value, "value does not match the type of the column compared to the placeholder" );
+    return QVariant::fromValue<typename Column::type>( value );
+}
+
+template <typename Column>
+QVariant placeholder_value( SqlNullType )
+{
+    static_assert( !Column::notNull::value, "NULL compared to a NOT NULL column" );
+    return QVariant();
+}
+
+/**
+ * Returns the placeholder names of @p where, checking them against the @p expected number of placeholder columns.
+ * @p statement covers all conditions of the prepared statement, placeholders outside of @p where are rejected.
+ * @throw SqlException if the placeholders are not all part of the type of the WHERE expression
+ * @internal
+ */
+inline QStringList prepared_placeholders( const SqlCondition &where, const SqlCondition &statement, int expected )
+{
+    QStringList placeholders;
+    where.collectPlaceholders( placeholders );
+    QStringList allPlaceholders;
+    statement.collectPlaceholders( allPlaceholders );
+    if ( placeholders.size() != expected || allPlaceholders != placeholders ) {
+        throw SqlException( QSqlError( QLatin1String( "Placeholders are only supported in the WHERE condition of prepared statements, outside of sub-queries" ),
+                                       QString(), QSqlError::StatementError ) );
+    }
+    return placeholders;
+}
+
+}
+
+/**
+ * A statement prepared once, which can be executed repeatedly with different values for its placeholders.
+ * Created by prepare() from an expression using Sql::placeholder, e.g.
+ * @code
+ * PreparedStatement<...> stmt = prepare( select( Person.id ).from( Person ).where( Person.PersonSurname == placeholder( "name" ) ) );
+ * stmt.exec( QString::fromLatin1( "Ford" ) );
+ * @endcode
+ * The values passed to exec() are checked against the types of the columns the placeholders are compared to,
+ * in the order the placeholders appear in the expression. A placeholder name used more than once is bound
+ * to a single parameter, from the value of its first occurrence; the values of later occurrences are only type-checked.
+ * Placeholders are only supported in the WHERE condition, not in JOIN conditions or sub-queries.
+ * Copies share the same prepared query.
+ * @tparam PlaceholderColumns MPL sequence of the columns compared to placeholders.
+ */
+template <typename PlaceholderColumns>
+class PreparedStatement
+{
+public:
+    /** Wraps the prepared @p query, whose placeholders are named @p placeholders. */
+    PreparedStatement( const SqlQuery &query, const QStringList &placeholders ) :
+        m_query( query ),
+        m_placeholders( placeholders ),
+        m_firstOccurrence( placeholders.size() )
+    {
+        for ( int i = 0; i < m_placeholders.size(); ++i )
+            m_firstOccurrence[i] = m_placeholders.indexOf( m_placeholders.at( i ) ) == i;
+    }
+
+    /**
+     * Binds @p values to the placeholders and executes the statement.
+     * @returns the executed query, for reading the results.
+     * @throw SqlException on execution errors
+     */
+    template <typename... Values>
+    SqlQuery& exec( const Values&... values )
+    {
+        static_assert( sizeof...(Values) == boost::mpl::size<PlaceholderColumns>::value, "exec() needs exactly one value per placeholder" );
+        bind<0>( values... );
+        m_query.exec();
+        return m_query;
+    }
+
+    /** The prepared query, e.g. for reading the results of the last exec(). */
+    SqlQuery& query() { return m_query; }
+
+private:
+    template <int I>
+    void bind() {}
+
+    template <int I, typename Value, typename... Values>
+    void bind( const Value &value, const Values&... values )
+    {
+        typedef typename boost::mpl::at_c<PlaceholderColumns, I>::type Column;
+        const QVariant v = detail::placeholder_value<Column>( value );
+        if ( m_firstOccurrence.at( I ) )
+            m_query.bindValue( m_placeholders.at( I ), SqlQueryBuilderBase::driverValue( v ) );
+        bind<I + 1>( values... );
+    }
+
+    SqlQuery m_query;
+    QStringList m_placeholders;
+    QVector<bool> m_firstOccurrence;
+};
+
+/**
+ * Prepares a SELECT statement for repeated execution.
+ * @throw SqlException if placeholders are used outside of the WHERE condition, e.g. in the HAVING condition
+ */
+template <typename ColumnList, typename TableT, typename JoinList, typename WhereExprT, typename GroupByList, typename SortList>
+PreparedStatement<typename detail::placeholder_columns<WhereExprT>::type>
+prepare( const SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> &expr )
+{
+    static_assert( boost::mpl::count_if<JoinList, detail::has_placeholders<boost::mpl::placeholders::_1> >::value == 0, "placeholders in JOIN conditions are not supported by prepare()" );
+    SqlSelectQueryBuilder qb = expr.queryBuilder();
+    SqlCondition statement;
+    statement.addExistsCondition( SqlCondition::Exists, qb );
+    const QStringList placeholders = detail::prepared_placeholders( expr.whereCondition, statement,
+                                                                    boost::mpl::size<typename detail::placeholder_columns<WhereExprT>::type>::value );
+    return PreparedStatement<typename detail::placeholder_columns<WhereExprT>::type>( qb.query(), placeholders );
+}
+
+/**
+ * Prepares a DELETE statement for repeated execution.
+ * @throw SqlException if placeholders are used in sub-queries
+ */
+template <typename TableT, typename WhereExprT>
+PreparedStatement<typename detail::placeholder_columns<WhereExprT>::type>
+prepare( const DeleteExpr<TableT, WhereExprT> &expr )
+{
+    const QStringList placeholders = detail::prepared_placeholders( expr.whereCondition, expr.whereCondition,
+                                                                    boost::mpl::size<typename detail::placeholder_columns<WhereExprT>::type>::value );
+    return PreparedStatement<typename detail::placeholder_columns<WhereExprT>::type>( expr.queryBuilder().query(), placeholders );
+}
+
+}
+
+#endif
@@ -49,7 +49,7 @@ SqlQuery::SqlQuery(const QSqlDatabase& db) :
 }
 
 SqlQuery::SqlQuery(const SqlQuery &other ) :
-    QSqlQuery( other ), m_db(other.m_db)
+    QSqlQuery( other ), m_db(other.m_db), m_lease(other.m_lease)
 {
     m_connectionName = m_db.connectionName();
     SqlQueryManager::instance()->registerQuery(this);
@@ -65,6 +65,7 @@ SqlQuery& SqlQuery::operator=(const SqlQuery& other)
     QSqlQuery::operator=(other);
     m_db = other.m_db;
     m_connectionName = m_db.connectionName();
+    m_lease = other.m_lease;
 //Debug line that helps finding leaking queries. It is intentionally not a SQLDEBUG.
 //     qDebug() << "operator= " <<  lastQuery() << this;
     return *this;
@@ -127,6 +128,33 @@ void SqlQuery::exec(const QString& query)
     }
 }
 
+void SqlQuery::execBatch(BatchExecutionMode mode)
+{
+    SqlQueryManager::instance()->checkDbIsAlive(m_db);
+
+#ifdef SQLATE_ENABLE_NETWORK_WATCHER
+    KDThreadRunner<SqlQueryWatcherHelper> watcher;
+    SqlQueryWatcherHelper* helper = watcher.startThread();
+#endif
+
+    bool result = QSqlQuery::execBatch( mode );
+    if (!result && ( !m_db.isOpen() || !m_db.isValid() ) ) {
+        SqlQueryManager::instance()->checkDbIsAlive(m_db);  //double check is needed, as Qt might not set m_db.isOpen() to false after connection loss if no queries were run meantime.
+        result = QSqlQuery::execBatch( mode );
+    }
+
+#ifdef SQLATE_ENABLE_NETWORK_WATCHER
+    QMetaObject::invokeMethod( helper, "quit", Qt::QueuedConnection );
+    watcher.wait();
+#endif
+
+    if ( !result ) {
+        qWarning() << Q_FUNC_INFO << "ExecBatch failed: " << this << QSqlQuery::lastError() << " query was: " << QSqlQuery::lastQuery()
+        << ", executed query: " << QSqlQuery::executedQuery()  << " bound values: "<< QSqlQuery::boundValues().values();
+        throw SqlException( QSqlQuery::lastError() );
+    }
+}
+
 void SqlQuery::prepare(const QString& query)
 {
     SqlQueryManager::instance()->checkDbIsAlive(m_db);
@@ -33,8 +33,18 @@
 
 #include "sqlate_export.h"
 
+#include <QSharedData>
 #include <QSqlQuery>
 
+/**
+ * @internal
+ * Shared by all copies of a query handed out by the statement pool in SqlQueryCache,
+ * the pool considers an instance idle once it holds the only reference.
+ */
+class SqlQueryLease : public QSharedData
+{
+};
+
 class SQLATE_EXPORT SqlQuery : public QSqlQuery
 {
 public:
@@ -52,6 +62,7 @@ public:
     // In short: do not cast.
     void exec();
     void exec( const QString &query );
+    void execBatch( BatchExecutionMode mode = ValuesAsRows );
     void prepare( const QString &query );
 
     /**
@@ -65,11 +76,17 @@ public:
 
     QString connectionName() const { return m_connectionName; }
 
+    /// @internal Attaches the statement pool lease @p lease, copies of this query share it.
+    void setLease( const QExplicitlySharedDataPointer<SqlQueryLease> &lease ) { m_lease = lease; }
+    /// @internal Returns the number of queries sharing the statement pool lease of this one, 0 if it is not pooled.
+    int leaseCount() const { return m_lease.data() ? m_lease->ref.load() : 0; }
+
     SqlQuery& operator=(const SqlQuery& other);
 
 private:
     QSqlDatabase m_db;
     QString m_connectionName;
+    QExplicitlySharedDataPointer<SqlQueryLease> m_lease;
 };
 
 #endif
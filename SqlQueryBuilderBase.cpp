@@ -24,11 +24,38 @@
 #include "SqlSchema.h"
 #include "SqlCondition.h"
 #include "SqlQueryCache.h"
+#include "SqlTransaction.h"
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QReadWriteLock>
+#include <QSqlDriver>
+#include <QSqlField>
+#include <QStringList>
+
+#include <algorithm>
+
+static QAtomicInt s_prepareThreshold( 1 );
+
+// statements rendered so far, by fingerprint, shared by all builders
+struct MemoizedStatement
+{
+    SqlQueryBuilderBase::Fingerprint fingerprint; // to rule out hash collisions
+    QString statement;
+};
+typedef QHash<quint64, MemoizedStatement> StatementHash;
+Q_GLOBAL_STATIC( StatementHash, s_statements )
+Q_GLOBAL_STATIC( QReadWriteLock, s_statementsLock )
+static const int MaxMemoizedStatements = 4096;
 
 SqlQueryBuilderBase::SqlQueryBuilderBase(const QSqlDatabase& db) :
   m_db( db ),
   m_query( db ),
-  m_assembled( false )
+  m_assembled( false ),
+  m_executedOneShot( false ),
+  m_prepared( false ),
+  m_fingerprint( Fingerprint::none() ),
+  m_inlinedValues( 0 )
 {
 }
 
@@ -47,29 +74,422 @@ void SqlQueryBuilderBase::setTable(const QString& tableName)
 void SqlQueryBuilderBase::invalidateQuery()
 {
     m_assembled = false;
+    m_executedOneShot = false;
+}
+
+void SqlQueryBuilderBase::setPrepareThreshold(int executions)
+{
+    s_prepareThreshold.store( executions );
+}
+
+int SqlQueryBuilderBase::prepareThreshold()
+{
+    return s_prepareThreshold.load();
 }
 
 void SqlQueryBuilderBase::exec()
 {
-    query().exec();
+    if ( !m_assembled ) {
+        m_executedOneShot = false;
+        assembleStatement();
+        if ( !m_prepared ) {
+            // with the default threshold everything is prepared right away, no need to count
+            const int threshold = prepareThreshold();
+            if ( threshold > 1 && SqlQueryCache::countExecution( m_db.connectionName(), m_queryString ) < threshold ) {
+                // not seen often enough to be worth a named prepare, m_assembled stays false so we get here again next time
+                m_query = SqlQuery( m_db );
+                m_query.exec( inlinedStatement() );
+                m_executedOneShot = true;
+                return;
+            }
+            m_query = prepareQuery( m_queryString );
+            m_prepared = true;
+        }
+        m_assembled = true;
+        bindQueryValues();
+    }
+    m_query.exec();
 }
 
-void SqlQueryBuilderBase::bindValue(int placeholderIndex, const QVariant& value)
+SqlQuery& SqlQueryBuilderBase::query()
 {
-    const QString placeholder = QLatin1Char(':') + QString::number( placeholderIndex );
+    if ( !m_assembled && !m_executedOneShot ) {
+        assembleStatement();
+        m_assembled = true;
+#ifndef QUERYBUILDER_UNITTEST
+        if ( !m_prepared ) {
+            if ( prepareThreshold() > 1 )
+                SqlQueryCache::countExecution( m_db.connectionName(), m_queryString );
+            m_query = prepareQuery( m_queryString );
+            m_prepared = true;
+        }
+        bindQueryValues();
+#endif
+    }
+    return m_query;
+}
+
+QString SqlQueryBuilderBase::statement()
+{
+    if ( !m_assembled )
+        assembleStatement();
+    return m_queryString;
+}
+
+SqlQueryBuilderBase::Fingerprint SqlQueryBuilderBase::fingerprint() const
+{
+    return Fingerprint::none();
+}
 
+void SqlQueryBuilderBase::collectBindValues()
+{
+    assembleQuery();
+}
+
+void SqlQueryBuilderBase::assembleStatement()
+{
+    Fingerprint fp = fingerprint();
+    // the statement text depends on the driver too, e.g. currentDateTime()
+    fp << m_db.driverName();
+    if ( fp == m_fingerprint ) {
+        // same structure as last time, m_queryString and m_query can be re-used as they are
+        collectBindValues();
+        return;
+    }
+
+    m_fingerprint = fp;
+    m_prepared = false;
+    if ( fp.isValid() ) {
+        QReadLocker locker( s_statementsLock() );
+        const StatementHash::const_iterator it = s_statements()->constFind( fp.value() );
+        if ( it != s_statements()->constEnd() && it->fingerprint == fp ) {
+            m_queryString = it->statement;
+            locker.unlock();
+            collectBindValues();
+            return;
+        }
+    }
+
+    assembleQuery();
+
+    if ( fp.isValid() ) {
+        QWriteLocker locker( s_statementsLock() );
+        if ( s_statements()->size() >= MaxMemoizedStatements )
+            s_statements()->clear();
+        const MemoizedStatement memo = { fp, m_queryString };
+        s_statements()->insert( fp.value(), memo );
+    }
+}
+
+SqlQueryBuilderBase::Fingerprint SqlQueryBuilderBase::Fingerprint::none()
+{
+    Fingerprint fp;
+    fp.m_valid = false;
+    return fp;
+}
+
+void SqlQueryBuilderBase::Fingerprint::add(const char* data, int size)
+{
+    if ( !m_valid )
+        return;
+    for ( int i = 0; i < size; ++i ) {
+        m_hash ^= static_cast<uchar>( data[i] );
+        m_hash *= Q_UINT64_C( 1099511628211 );
+    }
+    m_key.append( data, size );
+}
+
+SqlQueryBuilderBase::Fingerprint& SqlQueryBuilderBase::Fingerprint::operator<<(const QString& value)
+{
+    *this << value.size();
+    add( reinterpret_cast<const char*>( value.utf16() ), value.size() * static_cast<int>( sizeof( ushort ) ) );
+    return *this;
+}
+
+SqlQueryBuilderBase::Fingerprint& SqlQueryBuilderBase::Fingerprint::operator<<(const QLatin1String& value)
+{
+    *this << value.size();
+    add( value.data(), value.size() );
+    return *this;
+}
+
+SqlQueryBuilderBase::Fingerprint& SqlQueryBuilderBase::Fingerprint::operator<<(int value)
+{
+    add( reinterpret_cast<const char*>( &value ), static_cast<int>( sizeof( value ) ) );
+    return *this;
+}
+
+SqlQueryBuilderBase::Fingerprint& SqlQueryBuilderBase::Fingerprint::operator<<(const QVariant& value)
+{
+    // only the kind of value matters for the statement text, not the value itself
+    if ( !value.isValid() )
+        return *this << 0;
+    if ( value.userType() == qMetaTypeId<SqlNowType>() )
+        return *this << 1;
+    return *this << 2;
+}
+
+SqlQueryBuilderBase::Fingerprint& SqlQueryBuilderBase::Fingerprint::operator<<(const Fingerprint& other)
+{
+    if ( !other.m_valid )
+        m_valid = false;
+    *this << other.m_key.size();
+    add( other.m_key.constData(), other.m_key.size() );
+    return *this;
+}
+
+// formats a single element of a PostgreSQL array literal
+static QString arrayElement(const QVariant& value)
+{
+    if ( value.isNull() )
+        return QLatin1String( "NULL" );
+    QString text;
+    switch ( value.type() ) {
+        case QVariant::DateTime:
+            text = value.toDateTime().toUTC().toString( QLatin1String( "yyyy-MM-dd'T'hh:mm:ss.zzz'Z'" ) );
+            break;
+        case QVariant::ByteArray:
+            text = QLatin1String( "\\x" ) + QString::fromLatin1( value.toByteArray().toHex() );
+            break;
+        default:
+            text = value.toString();
+    }
+    text.replace( QLatin1Char( '\\' ), QLatin1String( "\\\\" ) );
+    text.replace( QLatin1Char( '"' ), QLatin1String( "\\\"" ) );
+    return QLatin1Char( '"' ) + text + QLatin1Char( '"' );
+}
+
+QVariant SqlQueryBuilderBase::driverValue(const QVariant& value)
+{
     if (value.userType() == qMetaTypeId<QUuid>()) {
          // Qt SQL drivers don't handle QUuid
-        m_query.bindValue( placeholder, value.value<QUuid>().toString() );
+        return value.value<QUuid>().toString();
     }
+    if (value.type() == QVariant::List) {
+        // Qt SQL drivers don't handle arrays, PostgreSQL casts the literal to the array type of the parameter
+        QStringList elements;
+        foreach ( const QVariant &element, value.toList() )
+            elements.push_back( arrayElement( driverValue( element ) ) );
+        return QString( QLatin1Char( '{' ) + elements.join( QLatin1String( "," ) ) + QLatin1Char( '}' ) );
+    }
+    return value;
+}
+
+bool SqlQueryBuilderBase::supportsArrayBinding(const QSqlDatabase& db)
+{
+    return db.driverName() == QLatin1String( "QPSQL" );
+}
 
-    else if (value.userType() == qMetaTypeId<SqlNowType>()) {
+SqlQuery SqlQueryBuilderBase::prepareStatement(const QString& statement, const QVector<QVariant>& values, const QSqlDatabase& db)
+{
+    SqlQuery query = SqlQueryCache::checkout( db, statement );
+    for ( int i = 0; i < values.size(); ++i )
+        query.bindValue( QLatin1Char( ':' ) + QString::number( i ), driverValue( values.at( i ) ) );
+    return query;
+}
+
+void SqlQueryBuilderBase::bindValue(int placeholderIndex, const QVariant& value)
+{
+    if (value.userType() == qMetaTypeId<SqlNowType>()) {
         // don't create any bindings for the SqlNow dummytype, it has been handled when assembling the query string already
+        return;
+    }
+
+    if (m_inlinedValues) {
+        m_inlinedValues->insert( placeholderIndex, driverValue( value ) );
+        return;
+    }
+
+    const QString placeholder = QLatin1Char(':') + QString::number( placeholderIndex );
+    m_query.bindValue( placeholder, driverValue( value ) );
+}
+
+void SqlQueryBuilderBase::execBatch(const QVector<QVariantList>& values, const QHash<QString, QVariantList>& namedValues)
+{
+    if ( m_executedOneShot )
+        invalidateQuery();
+    query(); // assemble and prepare
+
+    // the placeholders the builder binds values to
+    QHash<int, QVariant> bound;
+    m_inlinedValues = &bound;
+    bindQueryValues();
+    m_inlinedValues = 0;
+    QList<int> placeholders = bound.keys();
+    std::sort( placeholders.begin(), placeholders.end() );
+    if ( placeholders.size() != values.size() ) {
+        throw SqlException( QSqlError( QString::fromLatin1( "execBatch() got %1 value lists for %2 placeholders" ).arg( values.size() ).arg( placeholders.size() ),
+                                       QString(), QSqlError::StatementError ) );
+    }
+
+    int rows = -1;
+    QList<QVariantList> lists = values.toList();
+    lists += namedValues.values();
+    foreach ( const QVariantList &list, lists ) {
+        if ( rows >= 0 && rows != list.size() ) {
+            throw SqlException( QSqlError( QLatin1String( "execBatch() needs value lists of equal length" ),
+                                           QString(), QSqlError::StatementError ) );
+        }
+        rows = list.size();
+    }
+    if ( rows <= 0 )
+        return;
+
+    if ( m_db.driver()->hasFeature( QSqlDriver::BatchOperations ) ) {
+        for ( int i = 0; i < placeholders.size(); ++i ) {
+            QVariantList list;
+            list.reserve( rows );
+            foreach ( const QVariant &value, values.at( i ) )
+                list.push_back( driverValue( value ) );
+            m_query.bindValue( QLatin1Char( ':' ) + QString::number( placeholders.at( i ) ), list );
+        }
+        for ( QHash<QString, QVariantList>::const_iterator it = namedValues.constBegin(); it != namedValues.constEnd(); ++it ) {
+            QVariantList list;
+            list.reserve( rows );
+            foreach ( const QVariant &value, it.value() )
+                list.push_back( driverValue( value ) );
+            m_query.bindValue( it.key(), list );
+        }
+        m_query.execBatch();
+        return;
+    }
+
+    QStringList names;
+    names.reserve( placeholders.size() );
+    foreach ( int placeholder, placeholders )
+        names.push_back( QLatin1Char( ':' ) + QString::number( placeholder ) );
+
+    SqlTransaction transaction( m_db );
+    for ( int row = 0; row < rows; ++row ) {
+        for ( int i = 0; i < names.size(); ++i )
+            m_query.bindValue( names.at( i ), driverValue( values.at( i ).at( row ) ) );
+        for ( QHash<QString, QVariantList>::const_iterator it = namedValues.constBegin(); it != namedValues.constEnd(); ++it )
+            m_query.bindValue( it.key(), driverValue( it.value().at( row ) ) );
+        m_query.exec();
+    }
+    transaction.commit();
+}
+
+void SqlQueryBuilderBase::addReturningColumn(const QString& columnName)
+{
+    m_returningColumns.push_back( columnName );
+}
+
+QString SqlQueryBuilderBase::returningClause() const
+{
+    if ( m_returningColumns.isEmpty() )
+        return QString();
+    return QLatin1String( " RETURNING " ) % m_returningColumns.join( QLatin1String( ", " ) );
+}
+
+static bool isIdentifierChar( QChar c )
+{
+    return c.isLetterOrNumber() || c == QLatin1Char( '_' ) || c == QLatin1Char( '$' );
+}
+
+/**
+ * Returns the end of the string literal, quoted identifier or comment starting at @p pos in @p sql,
+ * or @p pos if there is none. Understands the PostgreSQL forms that can occur in raw fragments:
+ * '...' with doubled quotes, E'...' with backslash escapes, "...", $tag$...$tag$, -- and nested /* */ comments.
+ */
+static int skipLiteral( const QString &sql, int pos )
+{
+    const int size = sql.size();
+    const QChar c = sql.at( pos );
+    const QChar next = pos + 1 < size ? sql.at( pos + 1 ) : QChar();
+
+    if ( c == QLatin1Char( '-' ) && next == QLatin1Char( '-' ) ) {
+        const int end = sql.indexOf( QLatin1Char( '\n' ), pos + 2 );
+        return end < 0 ? size : end;
+    }
+
+    if ( c == QLatin1Char( '/' ) && next == QLatin1Char( '*' ) ) {
+        int depth = 1;
+        int i = pos + 2;
+        while ( i < size && depth > 0 ) {
+            if ( sql.at( i ) == QLatin1Char( '/' ) && i + 1 < size && sql.at( i + 1 ) == QLatin1Char( '*' ) ) {
+                ++depth;
+                i += 2;
+            } else if ( sql.at( i ) == QLatin1Char( '*' ) && i + 1 < size && sql.at( i + 1 ) == QLatin1Char( '/' ) ) {
+                --depth;
+                i += 2;
+            } else {
+                ++i;
+            }
+        }
+        return i;
+    }
+
+    if ( c == QLatin1Char( '$' ) && ( pos == 0 || !isIdentifierChar( sql.at( pos - 1 ) ) ) ) {
+        int tagEnd = pos + 1;
+        while ( tagEnd < size && sql.at( tagEnd ) != QLatin1Char( '$' ) && ( sql.at( tagEnd ).isLetter() || sql.at( tagEnd ) == QLatin1Char( '_' )
+                || ( tagEnd > pos + 1 && sql.at( tagEnd ).isDigit() ) ) )
+            ++tagEnd;
+        if ( tagEnd >= size || sql.at( tagEnd ) != QLatin1Char( '$' ) )
+            return pos; // not a dollar quote, e.g. a positional parameter
+        const QString tag = sql.mid( pos, tagEnd - pos + 1 );
+        const int end = sql.indexOf( tag, tagEnd + 1 );
+        return end < 0 ? size : end + tag.size();
+    }
+
+    if ( c == QLatin1Char( '\'' ) || c == QLatin1Char( '"' ) ) {
+        const bool escapes = c == QLatin1Char( '\'' ) && pos > 0 && ( sql.at( pos - 1 ) == QLatin1Char( 'E' ) || sql.at( pos - 1 ) == QLatin1Char( 'e' ) )
+                             && ( pos == 1 || !isIdentifierChar( sql.at( pos - 2 ) ) );
+        int i = pos + 1;
+        while ( i < size ) {
+            if ( escapes && sql.at( i ) == QLatin1Char( '\\' ) ) {
+                i += 2;
+            } else if ( sql.at( i ) == c ) {
+                if ( i + 1 < size && sql.at( i + 1 ) == c )
+                    i += 2; // doubled quote
+                else
+                    return i + 1;
+            } else {
+                ++i;
+            }
+        }
+        return size;
     }
 
-    else {
-        m_query.bindValue( placeholder, value );
+    return pos;
+}
+
+QString SqlQueryBuilderBase::inlinedStatement()
+{
+    QHash<int, QVariant> values;
+    m_inlinedValues = &values;
+    bindQueryValues();
+    m_inlinedValues = 0;
+
+    QString stmt;
+    stmt.reserve( m_queryString.size() );
+    for ( int i = 0; i < m_queryString.size(); ++i ) {
+        // placeholders inside literals and comments of raw fragments are left alone
+        const int literalEnd = skipLiteral( m_queryString, i );
+        if ( literalEnd > i ) {
+            stmt += m_queryString.midRef( i, literalEnd - i );
+            i = literalEnd - 1;
+            continue;
+        }
+        const QChar c = m_queryString.at( i );
+        if ( c == QLatin1Char( ':' ) && i + 1 < m_queryString.size() && m_queryString.at( i + 1 ).isDigit()
+             && ( i == 0 || m_queryString.at( i - 1 ) != QLatin1Char( ':' ) ) ) {
+            int end = i + 1;
+            while ( end < m_queryString.size() && m_queryString.at( end ).isDigit() )
+                ++end;
+            const int index = m_queryString.midRef( i + 1, end - i - 1 ).toInt();
+            if ( values.contains( index ) ) {
+                const QVariant value = values.value( index );
+                QSqlField field( QString(), value.type() );
+                field.setValue( value );
+                stmt += m_db.driver()->formatValue( field );
+                i = end - 1;
+                continue;
+            }
+        }
+        stmt += c;
     }
+    return stmt;
 }
 
 QString SqlQueryBuilderBase::currentDateTime() const
@@ -79,12 +499,5 @@ QString SqlQueryBuilderBase::currentDateTime() const
 
 SqlQuery SqlQueryBuilderBase::prepareQuery(const QString& sqlStatement)
 {
-    if (SqlQueryCache::contains(m_db.connectionName(), sqlStatement)) {
-        return SqlQueryCache::query(m_db.connectionName(), sqlStatement);
-    }
-
-    SqlQuery q( m_db );
-    q.prepare( sqlStatement );
-    SqlQueryCache::insert(m_db.connectionName(), sqlStatement, q);
-    return q;
+    return SqlQueryCache::checkout(m_db, sqlStatement);
 }
@@ -26,6 +26,10 @@
 #include "sqlate_export.h"
 #include "SqlGlobal.h"
 
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+
 /** Abstract base class for SQL query builders. All builders should inherit from this class.
  */
 class SQLATE_EXPORT SqlQueryBuilderBase
@@ -44,18 +48,107 @@ public:
     }
 
     /// Creates the query object and executes the query. The method throws an SqlException on error.
+    /// Statements executed less often than prepareThreshold() are sent to the server without a named prepare.
     virtual void exec();
 
     /// Returns the created query object, when called first, the query object is assembled and prepared
-    /// Subclasses must implement this method. The method throws an SqlException if there is an error preparing
-    /// the query.
-    virtual SqlQuery& query() = 0;
+    /// After exec() ran a statement without prepare, this returns the executed query for reading the results.
+    /// The method throws an SqlException if there is an error preparing the query.
+    virtual SqlQuery& query();
+
+    /// Returns the SQL statement of this query, assembling it if necessary, but without preparing it.
+    QString statement();
 
     /// Resets the internal status to "not assembled", meaning the query() call will assemble the query again.
     /// This makes possible to modify an already existing builder object after query() was used.
     void invalidateQuery();
 
+    /**
+     * Sets how often a statement has to be seen on a connection before exec() prepares it as a named statement
+     * and keeps it in the query cache. Until then, exec() sends it once with the values inlined by the SQL driver,
+     * which saves a roundtrip and leaves nothing behind on the server for one-off statements.
+     * The default of 1 prepares every statement and skips the counting. Otherwise the per-statement counters
+     * are available from SqlQueryCache::executionCounts().
+     * @note Only exec() applies this policy, query() always returns a prepared query.
+     */
+    static void setPrepareThreshold( int executions );
+    static int prepareThreshold();
+
+    /** Converts @p value into something the Qt SQL drivers can handle, e.g. QUuid into a string,
+     *  or a QVariantList into a PostgreSQL array literal.
+     */
+    static QVariant driverValue( const QVariant &value );
+
+    /**
+     * Returns @c true if a list of values can be bound as a single array parameter on @p db.
+     * @note This is unrelated to execBatch(): QPSQL has no QSqlDriver::BatchOperations, so a batch
+     * costs one round trip per row there. For large batches on PostgreSQL, prefer a single statement
+     * binding the column values as arrays, e.g. an IN condition or a multi-row insert.
+     */
+    static bool supportsArrayBinding( const QSqlDatabase &db );
+
+    /**
+     * Returns a prepared query for a statement rendered ahead of time, with @p values bound to the placeholders
+     * ":0" to ":n-1". This is used by the expression templates to skip the query builders for statements
+     * whose text only depends on the expression type.
+     * @throw SqlException if query preparation failed
+     */
+    static SqlQuery prepareStatement( const QString &statement, const QVector<QVariant> &values,
+                                      const QSqlDatabase &db = QSqlDatabase::database() );
+
+    /** Structural key of a statement, used by fingerprint().
+     *  Keeps the serialized structure next to its 64-bit FNV-1a hash, so that equal hashes can be verified.
+     */
+    class Fingerprint
+    {
+    public:
+        Fingerprint() : m_hash( Q_UINT64_C( 14695981039346656037 ) ), m_valid( true ) {}
+        /// a fingerprint that never matches, for statements that cannot be re-used
+        static Fingerprint none();
+        Fingerprint& operator<<( const QString &value );
+        Fingerprint& operator<<( const QLatin1String &value );
+        Fingerprint& operator<<( int value );
+        /// hashes the kind of value (NULL, server time or bound value) but not the value itself
+        Fingerprint& operator<<( const QVariant &value );
+        /// adds the structure of a nested statement, e.g. a sub-query, the result is invalid if @p other is
+        Fingerprint& operator<<( const Fingerprint &other );
+        bool isValid() const { return m_valid; }
+        quint64 value() const { return m_hash; }
+        bool operator==( const Fingerprint &other ) const
+        {
+            return m_valid && other.m_valid && m_hash == other.m_hash && m_key == other.m_key;
+        }
+        bool operator!=( const Fingerprint &other ) const { return !operator==( other ); }
+    private:
+        void add( const char *data, int size );
+        quint64 m_hash;
+        QByteArray m_key;
+        bool m_valid;
+    };
+
 protected:
+    /** Assembles the statement into m_queryString and collects the values to bind.
+     *  Subclasses must implement this method.
+     */
+    virtual void assembleQuery() = 0;
+
+    /** Binds the values collected by assembleQuery() to m_query.
+     *  Subclasses must implement this method.
+     */
+    virtual void bindQueryValues() = 0;
+
+    /** Returns the structure of everything that determines the statement text, but not the bound values.
+     *  Builders with equal fingerprints produce the same statement, so assembleQuery() only needs to run once
+     *  per structure, and re-using a builder with different values only needs to bind them again.
+     *  The default implementation returns Fingerprint::none(), which disables this.
+     */
+    virtual Fingerprint fingerprint() const;
+
+    /** Collects the values to bind without rendering the statement, for statements found by fingerprint().
+     *  The default implementation simply calls assembleQuery() again.
+     */
+    virtual void collectBindValues();
+
     /** Binds @p value to placeholder @p placeholderIndex in m_query.
      *  Unlike the similar methods in QSqlQuery this also applies transformations to handle types not supported
      *  by QtSQL, such as UUID.
@@ -63,15 +156,53 @@ protected:
      */
     void bindValue( int placeholderIndex, const QVariant &value );
 
+    /**
+     * Executes the statement once per entry in the given value arrays, which replace the values set on the builder.
+     * @p values contains one list per value bound by the builder, in the order of their placeholders,
+     * @p namedValues one list per named placeholder (e.g. from SqlCondition::addPlaceholderCondition()).
+     * All lists need to have the same length. Uses the batch support of the SQL driver if available,
+     * otherwise the statement is executed once per entry inside a single transaction, i.e. one round trip
+     * per entry, which is always the case for PostgreSQL, see supportsArrayBinding().
+     * The statement is rendered from the values set on the builder, so set a dummy value for every value
+     * to replace, otherwise its placeholder does not exist. The dummy values must not be SqlNow, nor NULL
+     * in conditions, as these are rendered into the statement instead of a placeholder.
+     * The method throws an SqlException on error, and if the number or the lengths of the lists do not match.
+     */
+    void execBatch( const QVector<QVariantList> &values, const QHash<QString, QVariantList> &namedValues = QHash<QString, QVariantList>() );
+
+    /**
+     * ... RETURNING @p columnName, ...
+     * The returned rows can be read from query() after executing the statement.
+     */
+    void addReturningColumn( const QString &columnName );
+
+    template <typename Column>
+    void addReturningColumn( const Column & )
+    {
+        addReturningColumn( Column::sqlName() );
+    }
+
+    /** Returns the RETURNING clause for the columns added with addReturningColumn(), or an empty string if there are none. */
+    QString returningClause() const;
+
+    /** Returns m_queryString with the placeholders replaced by the values bindQueryValues() binds, formatted by the SQL driver.
+     *  String literals, quoted identifiers, dollar quotes and comments, e.g. from column expressions, are copied verbatim. */
+    QString inlinedStatement();
+
     /** Returns the SQL expression returning the current date/time on the server depending on the used database backend. */
     QString currentDateTime() const;
 
     /** Returns a prepared query for the given @p sqlStatement.
      *  Unlike calling SqlQuery::prepare() manually, this will re-use cached prepared queries.
+     *  The returned query is exclusive to this builder until it is released again.
      *  @throw SqlException if query preparation failed
      */
     SqlQuery prepareQuery( const QString &sqlStatement );
 
+private:
+    /** Fills m_queryString and the values to bind, re-using an earlier statement of the same fingerprint if possible. */
+    void assembleStatement();
+
 protected:
     friend class SelectQueryBuilderTest;
     friend class SelectTest;
@@ -81,6 +212,11 @@ protected:
     SqlQuery m_query;
     QString m_queryString; // hold the assembled query string, used for unit testing
     bool m_assembled;
+    bool m_executedOneShot; // m_query was executed by exec() without prepare
+    bool m_prepared; // m_query is prepared for m_queryString
+    Fingerprint m_fingerprint; // fingerprint() of m_queryString, including the driver
+    QHash<int, QVariant> *m_inlinedValues; // collects the bound values instead of binding them, see inlinedStatement()
+    QStringList m_returningColumns;
 };
 
 #endif
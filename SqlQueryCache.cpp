@@ -22,35 +22,404 @@
 
 #include "SqlQuery.h"
 #include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
 
-static QHash<QString, QHash<QString, SqlQuery> > g_queryCache;
-static bool g_queryCacheEnabled = true;
+#include <list>
+
+namespace {
+
+/// Rough estimate of what an instance costs besides its statement text (QSqlQuery/QSqlResult and driver bookkeeping).
+static const qint64 InstanceOverhead = 512;
+
+/// Maximum number of statements we keep execution counters for, the least recently executed ones are dropped beyond that.
+static const int MaxExecutionCounters = 10000;
+
+/// All pooled prepared instances of one statement.
+struct CacheEntry
+{
+    QVector<SqlQuery> instances;
+    std::list<QString>::iterator lruPosition;
+};
+
+/// Number of executions of one statement, see SqlQueryBuilderBase::setPrepareThreshold().
+struct ExecutionCounter
+{
+    int executions;
+    std::list<QString>::iterator lruPosition;
+};
+
+/**
+ * The statement pool of a single database connection.
+ * Each connection has its own lock, so threads working on different connections never contend.
+ */
+struct ConnectionCache
+{
+    ConnectionCache( int maxEntries, qint64 maxBytes ) :
+        maxEntries( maxEntries ), maxBytes( maxBytes ), instanceCount( 0 ), bytes( 0 ),
+        hits( 0 ), misses( 0 ), evictions( 0 ), suspended( 0 )
+    {}
+
+    static qint64 instanceBytes( const QString &queryStatement )
+    {
+        return InstanceOverhead + queryStatement.size() * qint64( sizeof( QChar ) );
+    }
+
+    /// Moves @p entry to the front of the LRU list.
+    void touch( CacheEntry &entry )
+    {
+        lru.splice( lru.begin(), lru, entry.lruPosition );
+    }
+
+    /// Removes the least recently used statements until the cache fits into the given limits.
+    void shrink( int instanceLimit, qint64 byteLimit )
+    {
+        while ( !lru.empty() && ( instanceCount > instanceLimit || bytes > byteLimit ) ) {
+            remove( lru.back() );
+            ++evictions;
+        }
+    }
+
+    /**
+     * Drops all instances of @p queryStatement. Idle instances release their server-side statement right away,
+     * instances still checked out do so once their last user is gone.
+     */
+    void remove( const QString &queryStatement )
+    {
+        QHash<QString, CacheEntry>::iterator it = queries.find( queryStatement );
+        Q_ASSERT( it != queries.end() );
+        instanceCount -= it->instances.size();
+        bytes -= it->instances.size() * instanceBytes( queryStatement );
+        lru.erase( it->lruPosition );
+        queries.erase( it );
+    }
+
+    /**
+     * Adds @p query as new pooled instance of @p queryStatement, if that fits into the capacity.
+     * @returns @c true if @p query is now part of the pool.
+     */
+    bool add( const QString &queryStatement, SqlQuery &query, int maxInstances )
+    {
+        const qint64 size = instanceBytes( queryStatement );
+        QHash<QString, CacheEntry>::iterator it = queries.find( queryStatement );
+        if ( it == queries.end() ) {
+            if ( maxEntries <= 0 || size > maxBytes )
+                return false;
+            lru.push_front( queryStatement );
+            CacheEntry entry;
+            entry.lruPosition = lru.begin();
+            queries.insert( queryStatement, entry );
+        } else if ( it->instances.size() >= maxInstances ) {
+            return false;
+        } else {
+            touch( *it );
+        }
+
+        // make room, the statement we add to is the most recently used one and thus never evicted here
+        while ( lru.size() > 1 && ( instanceCount >= maxEntries || bytes + size > maxBytes ) ) {
+            remove( lru.back() );
+            ++evictions;
+        }
+
+        it = queries.find( queryStatement );
+        if ( instanceCount >= maxEntries || bytes + size > maxBytes ) {
+            if ( it->instances.isEmpty() ) {
+                lru.erase( it->lruPosition );
+                queries.erase( it );
+            }
+            return false;
+        }
+
+        query.setLease( QExplicitlySharedDataPointer<SqlQueryLease>( new SqlQueryLease ) );
+        it->instances.push_back( query );
+        ++instanceCount;
+        bytes += size;
+        return true;
+    }
+
+    void clear()
+    {
+        queries.clear();
+        lru.clear();
+        instanceCount = 0;
+        bytes = 0;
+    }
+
+    QMutex mutex;
+    QHash<QString, CacheEntry> queries;
+    std::list<QString> lru; ///< most recently used statement first
+    int maxEntries;
+    qint64 maxBytes;
+    int instanceCount;
+    qint64 bytes;
+    quint64 hits;
+    quint64 misses;
+    quint64 evictions;
+    int suspended; ///< number of active SchemaChangeGuard objects for this connection
+    QHash<QString, ExecutionCounter> executionCounts;
+    std::list<QString> executionLru; ///< most recently executed statement first
+};
+
+typedef QSharedPointer<ConnectionCache> ConnectionCachePtr;
+typedef QHash<QString, ConnectionCachePtr> ConnectionCacheHash;
+
+}
+
+Q_GLOBAL_STATIC(ConnectionCacheHash, g_queryCache)
+Q_GLOBAL_STATIC(QReadWriteLock, g_queryCacheLock)
+static QAtomicInt g_queryCacheEnabled( 1 );
+static QAtomicInt g_maxInstancesPerStatement( 4 );
+static int g_defaultMaxEntries = 1000;
+static qint64 g_defaultMaxBytes = 16 * 1024 * 1024;
+
+/**
+ * Returns the cache of @p dbConnectionName, optionally creating it.
+ * Only creating a new per-connection cache needs the exclusive lock, lookups of existing ones share the lock.
+ */
+static ConnectionCachePtr connectionCache( const QString &dbConnectionName, bool create )
+{
+    {
+        QReadLocker locker( g_queryCacheLock() );
+        const ConnectionCachePtr cache = g_queryCache()->value( dbConnectionName );
+        if ( cache || !create )
+            return cache;
+    }
+
+    QWriteLocker locker( g_queryCacheLock() );
+    ConnectionCachePtr &cache = (*g_queryCache())[dbConnectionName];
+    if ( !cache )
+        cache = ConnectionCachePtr( new ConnectionCache( g_defaultMaxEntries, g_defaultMaxBytes ) );
+    return cache;
+}
+
+/**
+ * Looks for an idle pooled instance of @p queryStatement in @p cache.
+ * @note @p cache must be locked.
+ */
+static bool findIdleInstance( ConnectionCache *cache, const QString &queryStatement, SqlQuery &query )
+{
+    QHash<QString, CacheEntry>::iterator it = cache->queries.find( queryStatement );
+    if ( it == cache->queries.end() )
+        return false;
+    for ( QVector<SqlQuery>::const_iterator instance = it->instances.constBegin(); instance != it->instances.constEnd(); ++instance ) {
+        // only the pool itself holds a reference to an idle instance
+        if ( instance->leaseCount() == 1 ) {
+            cache->touch( *it );
+            query = *instance;
+            return true;
+        }
+    }
+    return false;
+}
+
+SqlQuery SqlQueryCache::checkout(const QSqlDatabase &db, const QString &queryStatement)
+{
+    const QString dbConnectionName = db.connectionName();
+    const bool enabled = g_queryCacheEnabled.load();
+    const ConnectionCachePtr cache = connectionCache(dbConnectionName, enabled);
+    if (enabled) {
+        QMutexLocker locker(&cache->mutex);
+        if (!cache->suspended) {
+            SqlQuery q( db );
+            if (findIdleInstance(cache.data(), queryStatement, q)) {
+                ++cache->hits;
+                return q;
+            }
+            ++cache->misses;
+        }
+    }
+
+    // prepare without holding the lock, this is a server roundtrip
+    SqlQuery q( db );
+    q.prepare( queryStatement );
+
+    if (enabled) {
+        QMutexLocker locker(&cache->mutex);
+        if (!cache->suspended)
+            cache->add(queryStatement, q, g_maxInstancesPerStatement.load());
+    }
+    return q;
+}
 
 bool SqlQueryCache::contains(const QString &dbConnectionName, const QString& queryStatement)
 {
-    if (!g_queryCacheEnabled)
+    if (!g_queryCacheEnabled.load())
+        return false;
+    const ConnectionCachePtr cache = connectionCache(dbConnectionName, true);
+    QMutexLocker locker(&cache->mutex);
+    if (cache->suspended)
         return false;
-    return g_queryCache.contains(dbConnectionName) && g_queryCache.value(dbConnectionName).contains(queryStatement);
+    const QHash<QString, CacheEntry>::iterator it = cache->queries.find(queryStatement);
+    if (it != cache->queries.end()) {
+        foreach (const SqlQuery &instance, it->instances) {
+            if (instance.leaseCount() == 1) {
+                // callers check before using the statement, so this counts as use for the LRU order
+                cache->touch(*it);
+                return true;
+            }
+        }
+    }
+    return false;
 }
 
 SqlQuery SqlQueryCache::query(const QString &dbConnectionName, const QString& queryStatement)
 {
-    return g_queryCache.value(dbConnectionName).value(queryStatement);
+    SqlQuery q( QSqlDatabase::database( dbConnectionName, false ) );
+    const ConnectionCachePtr cache = connectionCache(dbConnectionName, false);
+    if (!cache)
+        return q;
+    QMutexLocker locker(&cache->mutex);
+    if (findIdleInstance(cache.data(), queryStatement, q))
+        ++cache->hits;
+    return q;
 }
 
 void SqlQueryCache::insert(const QString &dbConnectionName, const QString& queryStatement, const SqlQuery& query)
 {
-    if (g_queryCacheEnabled)
-        g_queryCache[dbConnectionName].insert(queryStatement, query);
+    if (!g_queryCacheEnabled.load())
+        return;
+    const ConnectionCachePtr cache = connectionCache(dbConnectionName, true);
+    QMutexLocker locker(&cache->mutex);
+    if (cache->suspended)
+        return;
+    SqlQuery pooled( query );
+    cache->add(queryStatement, pooled, g_maxInstancesPerStatement.load());
+}
+
+int SqlQueryCache::countExecution(const QString &dbConnectionName, const QString &queryStatement)
+{
+    const ConnectionCachePtr cache = connectionCache(dbConnectionName, true);
+    QMutexLocker locker(&cache->mutex);
+    QHash<QString, ExecutionCounter>::iterator it = cache->executionCounts.find(queryStatement);
+    if (it == cache->executionCounts.end()) {
+        // ad-hoc statements would let this grow forever, forget about the ones not executed for the longest time
+        if (cache->executionCounts.size() >= MaxExecutionCounters) {
+            cache->executionCounts.remove(cache->executionLru.back());
+            cache->executionLru.pop_back();
+        }
+        cache->executionLru.push_front(queryStatement);
+        const ExecutionCounter counter = { 0, cache->executionLru.begin() };
+        it = cache->executionCounts.insert(queryStatement, counter);
+    } else {
+        cache->executionLru.splice(cache->executionLru.begin(), cache->executionLru, it->lruPosition);
+    }
+    return ++it->executions;
+}
+
+QHash<QString, int> SqlQueryCache::executionCounts(const QString &dbConnectionName)
+{
+    const ConnectionCachePtr cache = connectionCache(dbConnectionName, false);
+    if (!cache)
+        return QHash<QString, int>();
+    QMutexLocker locker(&cache->mutex);
+    QHash<QString, int> counts;
+    counts.reserve(cache->executionCounts.size());
+    for (QHash<QString, ExecutionCounter>::const_iterator it = cache->executionCounts.constBegin(); it != cache->executionCounts.constEnd(); ++it)
+        counts.insert(it.key(), it->executions);
+    return counts;
 }
 
 void SqlQueryCache::clear()
 {
-    g_queryCache.clear();
+    QReadLocker locker(g_queryCacheLock());
+    foreach (const ConnectionCachePtr &cache, *g_queryCache()) {
+        QMutexLocker cacheLocker(&cache->mutex);
+        cache->clear();
+    }
+}
+
+void SqlQueryCache::clear(const QString &dbConnectionName)
+{
+    const ConnectionCachePtr cache = connectionCache(dbConnectionName, false);
+    if (!cache)
+        return;
+    QMutexLocker locker(&cache->mutex);
+    cache->clear();
+}
+
+void SqlQueryCache::invalidateTables(const QStringList &tableNames)
+{
+    if (tableNames.isEmpty())
+        return;
+
+    QStringList escapedNames;
+    foreach (const QString &tableName, tableNames)
+        escapedNames.push_back(QRegularExpression::escape(tableName));
+    // unquoted SQL identifiers are case-insensitive
+    const QRegularExpression tableReference(QLatin1String("\\b(") + escapedNames.join(QLatin1Char('|')) + QLatin1String(")\\b"),
+                                            QRegularExpression::CaseInsensitiveOption);
+
+    QReadLocker locker(g_queryCacheLock());
+    foreach (const ConnectionCachePtr &cache, *g_queryCache()) {
+        QMutexLocker cacheLocker(&cache->mutex);
+        const QStringList statements = cache->queries.keys();
+        foreach (const QString &statement, statements) {
+            if (tableReference.match(statement).hasMatch())
+                cache->remove(statement);
+        }
+    }
 }
 
 void SqlQueryCache::setEnabled(bool enable)
 {
-    g_queryCacheEnabled = enable;
+    g_queryCacheEnabled.store(enable ? 1 : 0);
     clear();
 }
+
+void SqlQueryCache::setCapacity(const QString &dbConnectionName, int maxEntries, qint64 maxBytes)
+{
+    const ConnectionCachePtr cache = connectionCache(dbConnectionName, true);
+    QMutexLocker locker(&cache->mutex);
+    cache->maxEntries = maxEntries;
+    cache->maxBytes = maxBytes;
+    cache->shrink(maxEntries, maxBytes);
+}
+
+void SqlQueryCache::setDefaultCapacity(int maxEntries, qint64 maxBytes)
+{
+    QWriteLocker locker(g_queryCacheLock());
+    g_defaultMaxEntries = maxEntries;
+    g_defaultMaxBytes = maxBytes;
+}
+
+void SqlQueryCache::setMaxInstancesPerStatement(int maxInstances)
+{
+    g_maxInstancesPerStatement.store(maxInstances);
+}
+
+SqlQueryCache::Statistics SqlQueryCache::statistics(const QString &dbConnectionName)
+{
+    Statistics stats = { 0, 0, 0, 0, 0 };
+    const ConnectionCachePtr cache = connectionCache(dbConnectionName, false);
+    if (!cache)
+        return stats;
+    QMutexLocker locker(&cache->mutex);
+    stats.hits = cache->hits;
+    stats.misses = cache->misses;
+    stats.evictions = cache->evictions;
+    stats.entries = cache->instanceCount;
+    stats.bytes = cache->bytes;
+    return stats;
+}
+
+SqlQueryCache::SchemaChangeGuard::SchemaChangeGuard(const QString &dbConnectionName, const QStringList &tableNames) :
+    m_dbConnectionName(dbConnectionName),
+    m_tableNames(tableNames)
+{
+    const ConnectionCachePtr cache = connectionCache(m_dbConnectionName, true);
+    QMutexLocker locker(&cache->mutex);
+    ++cache->suspended;
+}
+
+SqlQueryCache::SchemaChangeGuard::~SchemaChangeGuard()
+{
+    invalidateTables(m_tableNames);
+
+    const ConnectionCachePtr cache = connectionCache(m_dbConnectionName, true);
+    QMutexLocker locker(&cache->mutex);
+    --cache->suspended;
+}
@@ -23,28 +23,104 @@
 
 #include "sqlate_export.h"
 
-class QString;
+#include <QHash>
+#include <QStringList>
+
+class QSqlDatabase;
 class SqlQuery;
 
 /**
  * A per-connection cache prepared query cache.
+ * The cache is a statement pool, every user gets an exclusive prepared instance of a statement,
+ * so queries with the same statement text don't overwrite each other's bound values or results.
+ * An instance returns to the pool automatically once its last copy is destroyed.
+ * Each connection cache is bounded, both in the number of prepared instances and in their approximate size,
+ * the least recently used statements are evicted first.
+ * All functions are thread-safe. Every database connection has its own cache with its own lock,
+ * so threads using different connections do not contend for the cache.
  */
 namespace SqlQueryCache
 {
-    /// Check whether the query @p queryStatement is cached already.
+    /**
+     * Returns an exclusive prepared instance of @p queryStatement on @p db.
+     * An idle pooled instance is re-used if available, otherwise a new one is prepared and added to the pool,
+     * as long as the per-statement limit and the capacity of the connection cache allow that.
+     * @throw SqlException if query preparation failed
+     */
+    SQLATE_EXPORT SqlQuery checkout( const QSqlDatabase& db, const QString& queryStatement );
+
+    /// Check whether an idle instance of the query @p queryStatement is cached already, marking it as recently used if so.
     SQLATE_EXPORT bool contains( const QString& dbConnectionName, const QString& queryStatement );
 
-    /// Returns the cached (and prepared) query for @p queryStatement.
+    /// Returns an idle cached (and prepared) instance for @p queryStatement, an unprepared query if there is none.
     SQLATE_EXPORT SqlQuery query( const QString& dbConnectionName, const QString& queryStatement );
 
-    /// Insert @p query into the cache for @p queryStatement.
+    /// Insert @p query into the cache for @p queryStatement. The pool takes over @p query, use it via query() afterwards.
     SQLATE_EXPORT void insert( const QString& dbConnectionName, const QString& queryStatement, const SqlQuery& query );
 
-    /// Clears the cache, must be called whenever the corresponding database connection is dropped.
+    /// Clears the cache of all connections.
     SQLATE_EXPORT void clear();
 
+    /// Clears the cache of @p dbConnectionName, must be called whenever that database connection is dropped.
+    SQLATE_EXPORT void clear( const QString& dbConnectionName );
+
+    /// Removes all statements referencing one of the tables @p tableNames from the caches of all connections.
+    SQLATE_EXPORT void invalidateTables( const QStringList& tableNames );
+
     /// Enables/disables the query cache. This can be used to temporarily disable caching while changing the db layout.
     SQLATE_EXPORT void setEnabled( bool enable );
+
+    /**
+     * Limits the cache of @p dbConnectionName to @p maxEntries prepared instances and about @p maxBytes bytes.
+     * Evicted statements are dropped from the cache, their server-side prepared statement is deallocated
+     * as soon as no query builder uses it anymore.
+     */
+    SQLATE_EXPORT void setCapacity( const QString& dbConnectionName, int maxEntries, qint64 maxBytes );
+
+    /// Sets the capacity used for connections without an explicit setCapacity() call, defaults to 1000 entries and 16MiB.
+    SQLATE_EXPORT void setDefaultCapacity( int maxEntries, qint64 maxBytes );
+
+    /**
+     * Limits the number of pooled instances per statement, defaults to 4.
+     * If all of them are in use, checkout() returns an additional uncached instance.
+     */
+    SQLATE_EXPORT void setMaxInstancesPerStatement( int maxInstances );
+
+    /// Usage statistics of a connection cache.
+    struct Statistics
+    {
+        quint64 hits;
+        quint64 misses;
+        quint64 evictions;
+        int entries; ///< number of currently pooled prepared instances
+        qint64 bytes; ///< approximate current size of the cache
+    };
+
+    /// Returns the usage statistics for the cache of @p dbConnectionName.
+    SQLATE_EXPORT Statistics statistics( const QString& dbConnectionName );
+
+    /// Counts an execution of @p queryStatement on @p dbConnectionName, returns the number of executions seen so far.
+    SQLATE_EXPORT int countExecution( const QString& dbConnectionName, const QString& queryStatement );
+
+    /// Returns the number of executions per statement on @p dbConnectionName, see SqlQueryBuilderBase::setPrepareThreshold().
+    SQLATE_EXPORT QHash<QString, int> executionCounts( const QString& dbConnectionName );
+
+    /**
+     * Suspends caching on one connection while the tables of a schema are changed.
+     * On destruction all cached statements referencing one of the changed tables are invalidated,
+     * on all connections, and caching is resumed. Statements on other tables stay cached.
+     */
+    class SQLATE_EXPORT SchemaChangeGuard
+    {
+    public:
+        SchemaChangeGuard( const QString& dbConnectionName, const QStringList& tableNames );
+        ~SchemaChangeGuard();
+
+    private:
+        Q_DISABLE_COPY( SchemaChangeGuard )
+        const QString m_dbConnectionName;
+        const QStringList m_tableNames;
+    };
 }
 
 #endif
@@ -23,6 +23,7 @@
 #include "SqlQuery.h"
 #include "SqlMonitor.h"
 #include "SqlQueryCache.h"
+#include "SqlQueryWarmup.h"
 
 #include <QCoreApplication>
 #include <QMap>
@@ -130,6 +131,7 @@ void SqlQueryManager::checkDbIsAlive(QSqlDatabase& db)
         allBoundValues[q] = q->boundValues();
     }
     int retryCount = 0;
+    bool reopened = false;
     while ( !db.isOpen() || !db.isValid() ) {
         if ( QThread::currentThread() == QCoreApplication::instance()->thread() ) {
 #if 0
@@ -148,7 +150,8 @@ void SqlQueryManager::checkDbIsAlive(QSqlDatabase& db)
         }
 
        if ( db.open() ) {
-        SqlQueryCache::clear(); // reconnected, so all cached queries are now invalid
+        reopened = true;
+        SqlQueryCache::clear(db.connectionName()); // reconnected, so all cached queries of this connection are now invalid
         //if the connection was dropped and recreated all the prepared queries are invalid, so we need to reconstruct them
         //using the lastQuery() string and the saved bound values
         Q_FOREACH(SqlQuery* q, m_queries ) {
@@ -180,6 +183,12 @@ void SqlQueryManager::checkDbIsAlive(QSqlDatabase& db)
         }
        }
     }
+
+    // prepare the registered statements again, the warm-up uses SqlQuery and so needs the locks
+    monitorLocker.unlock();
+    queryLocker.unlock();
+    if ( reopened )
+        SqlQueryWarmup::warmUp( db );
 }
 
 
@@ -0,0 +1,119 @@
+/*
+    Copyright (C) 2013 Klarälvdalens Datakonsult AB,
+        a KDAB Group company, info@kdab.net,
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+#include "SqlQueryWarmup.h"
+
+#include "SqlExceptions.h"
+#include "SqlGlobal.h"
+#include "SqlQueryCache.h"
+#include "SqlTransaction.h"
+
+#include <QMutex>
+#include <QTimer>
+
+Q_GLOBAL_STATIC(QMutex, g_registryMutex)
+Q_GLOBAL_STATIC(QStringList, g_registeredStatements)
+
+void SqlQueryWarmup::registerStatement(const QString &statement)
+{
+    QMutexLocker locker(g_registryMutex());
+    if (!g_registeredStatements()->contains(statement))
+        g_registeredStatements()->push_back(statement);
+}
+
+void SqlQueryWarmup::registerBuilder(SqlQueryBuilderBase &builder)
+{
+    registerStatement(builder.statement());
+}
+
+QStringList SqlQueryWarmup::registeredStatements()
+{
+    QMutexLocker locker(g_registryMutex());
+    return *g_registeredStatements();
+}
+
+bool SqlQueryWarmup::prepare(const QSqlDatabase &db, const QString &statement)
+{
+    try {
+        // the idle instance goes back into the pool right away
+        SqlQueryCache::checkout(db, statement);
+        return true;
+    } catch (const SqlException &e) {
+        SQLDEBUG << "Warm-up failed to prepare" << statement << e.error().text();
+    }
+    return false;
+}
+
+SqlQueryWarmup* SqlQueryWarmup::instance()
+{
+    static SqlQueryWarmup *s_instance = new SqlQueryWarmup(QSqlDatabase());
+    return s_instance;
+}
+
+qint64 SqlQueryWarmup::warmUp(const QSqlDatabase &db)
+{
+    if (SqlTransaction::isActive(db))
+        return -1;
+    QElapsedTimer timer;
+    timer.start();
+    int prepared = 0;
+    foreach (const QString &statement, registeredStatements()) {
+        if (prepare(db, statement))
+            ++prepared;
+    }
+    const qint64 elapsed = timer.elapsed();
+    emit instance()->warmedUp(db.connectionName(), prepared, elapsed);
+    return elapsed;
+}
+
+SqlQueryWarmup* SqlQueryWarmup::warmUpInBackground(const QSqlDatabase &db)
+{
+    SqlQueryWarmup *warmup = new SqlQueryWarmup(db);
+    QTimer::singleShot(0, warmup, SLOT(prepareNext()));
+    return warmup;
+}
+
+SqlQueryWarmup::SqlQueryWarmup(const QSqlDatabase &db, QObject *parent) :
+    QObject(parent),
+    m_db(db),
+    m_pendingStatements(registeredStatements()),
+    m_preparedStatements(0)
+{
+    m_timer.start();
+}
+
+void SqlQueryWarmup::prepareNext()
+{
+    if (!m_pendingStatements.isEmpty()) {
+        if (SqlTransaction::isActive(m_db)) {
+            // e.g. from a nested event loop, check back later
+            QTimer::singleShot(50, this, SLOT(prepareNext()));
+            return;
+        }
+        if (prepare(m_db, m_pendingStatements.takeFirst()))
+            ++m_preparedStatements;
+        QTimer::singleShot(0, this, SLOT(prepareNext()));
+        return;
+    }
+
+    const qint64 elapsed = m_timer.elapsed();
+    emit finished(m_preparedStatements, elapsed);
+    emit instance()->warmedUp(m_db.connectionName(), m_preparedStatements, elapsed);
+    deleteLater();
+}
@@ -0,0 +1,97 @@
+/*
+    Copyright (C) 2013 Klarälvdalens Datakonsult AB,
+        a KDAB Group company, info@kdab.net,
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+#ifndef SQLQUERYWARMUP_H
+#define SQLQUERYWARMUP_H
+
+#include "sqlate_export.h"
+#include "SqlQueryBuilderBase.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QStringList>
+
+/**
+ * Registry of statements to prepare up front, to avoid paying the prepare roundtrip on the first use of a query.
+ * Register expressions or query builders during application startup, and call warmUp() or warmUpInBackground()
+ * in the thread of a connection right after opening it, before serving requests with it.
+ * Connections re-established by SqlQueryManager::checkDbIsAlive() are warmed up again automatically.
+ * The warm-up never runs inside an open SqlTransaction, as a statement failing to prepare would abort it.
+ * instance() reports each finished warm-up through warmedUp().
+ */
+class SQLATE_EXPORT SqlQueryWarmup : public QObject
+{
+    Q_OBJECT
+public:
+    /// Registers @p statement for being prepared on each connection.
+    static void registerStatement( const QString &statement );
+
+    /// Registers the statement created by the query builder @p builder.
+    static void registerBuilder( SqlQueryBuilderBase &builder );
+
+    /// Registers the statement created by the expression @p expr, such as Sql::select(), Sql::insert() or Sql::del().
+    template <typename Expr>
+    static void registerExpression( const Expr &expr )
+    {
+        auto builder = expr.queryBuilder();
+        registerBuilder( builder );
+    }
+
+    /// Returns all registered statements.
+    static QStringList registeredStatements();
+
+    /// Returns the object emitting warmedUp() for every connection.
+    static SqlQueryWarmup* instance();
+
+    /**
+     * Prepares all registered statements on @p db and puts them into the query cache.
+     * @returns The time the warm-up took, in milliseconds, or -1 if it was skipped because of an open SqlTransaction on @p db.
+     */
+    static qint64 warmUp( const QSqlDatabase &db );
+
+    /**
+     * Prepares all registered statements on @p db from the event loop, one at a time, so the application stays responsive.
+     * Since a database connection can only be used from the thread it was created in, this needs an event loop in that thread.
+     * Statements are not prepared while a SqlTransaction is open on @p db, the job waits for it to end instead.
+     * @returns The warm-up job, which emits finished() and deletes itself when done.
+     */
+    static SqlQueryWarmup* warmUpInBackground( const QSqlDatabase &db );
+
+Q_SIGNALS:
+    /// Emitted when the background warm-up is done, with the number of prepared statements and the time it took.
+    void finished( int preparedStatements, qint64 elapsedMsecs );
+
+    /// Emitted by instance() whenever a warm-up of the connection @p connectionName is done, from the thread of that connection.
+    void warmedUp( const QString &connectionName, int preparedStatements, qint64 elapsedMsecs );
+
+private Q_SLOTS:
+    void prepareNext();
+
+private:
+    explicit SqlQueryWarmup( const QSqlDatabase &db, QObject *parent = 0 );
+    static bool prepare( const QSqlDatabase &db, const QString &statement );
+
+    QSqlDatabase m_db;
+    QStringList m_pendingStatements;
+    QElapsedTimer m_timer;
+    int m_preparedStatements;
+};
+
+#endif
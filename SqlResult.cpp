@@ -0,0 +1,64 @@
+/*
+    Copyright (C) 2013 Klarälvdalens Datakonsult AB,
+        a KDAB Group company, info@kdab.net,
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+#include "SqlResult.h"
+
+#include <QSqlDriver>
+#include <QSqlResult>
+
+#ifdef SQLATE_HAVE_POSTGRESQL
+#include <libpq-fe.h>
+#endif
+
+SqlRawResult::SqlRawResult(const QSqlQuery& query) :
+    m_query( &query ),
+    m_result( 0 )
+{
+}
+
+void SqlRawResult::update()
+{
+    m_result = 0;
+#ifdef SQLATE_HAVE_POSTGRESQL
+    // forward-only queries might receive one result per row, so this can change between rows
+    const QVariant handle = m_query->result() ? m_query->result()->handle() : QVariant();
+    if ( handle.isValid() && qstrcmp( handle.typeName(), "PGresult*" ) == 0 ) {
+        PGresult *result = *static_cast<PGresult* const*>( handle.constData() );
+        if ( result && PQnfields( result ) > 0 && PQfformat( result, 0 ) == 0 )
+            m_result = result;
+    }
+#endif
+}
+
+const char* SqlRawResult::value(int column, int* length) const
+{
+#ifdef SQLATE_HAVE_POSTGRESQL
+    const PGresult *result = static_cast<const PGresult*>( m_result );
+    const int row = PQntuples( result ) == 1 ? 0 : m_query->at();
+    if ( PQgetisnull( result, row, column ) )
+        return 0;
+    *length = PQgetlength( result, row, column );
+    return PQgetvalue( result, row, column );
+#else
+    Q_UNUSED( column );
+    Q_UNUSED( length );
+    Q_ASSERT( false );
+    return 0;
+#endif
+}
@@ -0,0 +1,448 @@
+/*
+    Copyright (C) 2013 Klarälvdalens Datakonsult AB,
+        a KDAB Group company, info@kdab.net,
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+#ifndef SQLRESULT_H
+#define SQLRESULT_H
+
+#include "sqlate_export.h"
+#include "SqlQuery.h"
+#include "SqlSelect.h"
+
+#include <QByteArray>
+#include <QDate>
+#include <QDateTime>
+#include <QString>
+#include <QTime>
+#include <QUuid>
+#include <QVariant>
+
+#include <boost/mpl/begin_end.hpp>
+#include <boost/mpl/distance.hpp>
+#include <boost/mpl/find.hpp>
+#include <boost/mpl/fold.hpp>
+#include <boost/mpl/placeholders.hpp>
+#include <boost/mpl/size.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+#include <array>
+#include <iterator>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * @file SqlResult.h
+ * Typed access to the rows and columns of a SELECT expression.
+ */
+
+/**
+ * @internal
+ * Direct access to the text representation of the cells of an executed query, bypassing QVariant.
+ * Only available for the QPSQL driver and if sqlate was built with libpq, isValid() returns @c false otherwise.
+ */
+class SQLATE_EXPORT SqlRawResult
+{
+public:
+    explicit SqlRawResult( const QSqlQuery &query );
+
+    /// Picks up the result of the current row, needs to be called after every QSqlQuery::next().
+    void update();
+
+    bool isValid() const { return m_result != 0; }
+
+    /// Returns the text of @p column in the current row of the query, or 0 for NULL values.
+    const char* value( int column, int *length ) const;
+
+private:
+    const QSqlQuery *m_query;
+    void *m_result;
+};
+
+namespace Sql {
+
+namespace detail {
+
+/**
+ * Decoders for the C++ types of columns, from a QVariant or from the PostgreSQL text format.
+ * @internal
+ */
+template <typename T> struct value_decoder
+{
+    static T fromVariant( const QVariant &value ) { return value.value<T>(); }
+    static T fromText( const char *data, int length ) { return fromVariant( QString::fromUtf8( data, length ) ); }
+};
+
+template <> struct value_decoder<QString>
+{
+    static QString fromVariant( const QVariant &value ) { return value.toString(); }
+    static QString fromText( const char *data, int length ) { return QString::fromUtf8( data, length ); }
+};
+
+template <> struct value_decoder<int>
+{
+    static int fromVariant( const QVariant &value ) { return value.toInt(); }
+    static int fromText( const char *data, int length ) { return QByteArray::fromRawData( data, length ).toInt(); }
+};
+
+template <> struct value_decoder<qlonglong>
+{
+    static qlonglong fromVariant( const QVariant &value ) { return value.toLongLong(); }
+    static qlonglong fromText( const char *data, int length ) { return QByteArray::fromRawData( data, length ).toLongLong(); }
+};
+
+template <> struct value_decoder<double>
+{
+    static double fromVariant( const QVariant &value ) { return value.toDouble(); }
+    static double fromText( const char *data, int length ) { return QByteArray::fromRawData( data, length ).toDouble(); }
+};
+
+template <> struct value_decoder<float>
+{
+    static float fromVariant( const QVariant &value ) { return value.toFloat(); }
+    static float fromText( const char *data, int length ) { return QByteArray::fromRawData( data, length ).toFloat(); }
+};
+
+template <> struct value_decoder<bool>
+{
+    static bool fromVariant( const QVariant &value ) { return value.toBool(); }
+    static bool fromText( const char *data, int length ) { return length > 0 && data[0] == 't'; }
+};
+
+template <> struct value_decoder<QUuid>
+{
+    static QUuid fromVariant( const QVariant &value )
+    {
+        if ( value.userType() == qMetaTypeId<QUuid>() )
+            return value.value<QUuid>();
+        return QUuid( value.toString() );
+    }
+    static QUuid fromText( const char *data, int length ) { return QUuid( QByteArray::fromRawData( data, length ) ); }
+};
+
+template <> struct value_decoder<QDate>
+{
+    static QDate fromVariant( const QVariant &value ) { return value.toDate(); }
+    static QDate fromText( const char *data, int length ) { return QDate::fromString( QString::fromLatin1( data, length ), Qt::ISODate ); }
+};
+
+template <> struct value_decoder<QTime>
+{
+    static QTime fromVariant( const QVariant &value ) { return value.toTime(); }
+    static QTime fromText( const char *data, int length ) { return QTime::fromString( QString::fromLatin1( data, length ), Qt::ISODate ); }
+};
+
+template <> struct value_decoder<QDateTime>
+{
+    static QDateTime fromVariant( const QVariant &value ) { return value.toDateTime(); }
+    static QDateTime fromText( const char *data, int length )
+    {
+        // same as the QPSQL driver: "2013-01-01 12:00:00+01" lacks the minutes of the UTC offset for ISO 8601
+        QString text = QString::fromLatin1( data, length );
+        if ( text.size() > 3 && ( text.at( text.size() - 3 ) == QLatin1Char( '+' ) || text.at( text.size() - 3 ) == QLatin1Char( '-' ) ) )
+            text += QLatin1String( ":00" );
+        return QDateTime::fromString( text, Qt::ISODate ).toLocalTime();
+    }
+};
+
+template <> struct value_decoder<QByteArray>
+{
+    static QByteArray fromVariant( const QVariant &value ) { return value.toByteArray(); }
+    static QByteArray fromText( const char *data, int length )
+    {
+        // bytea hex format
+        if ( length >= 2 && data[0] == '\\' && data[1] == 'x' )
+            return QByteArray::fromHex( QByteArray::fromRawData( data + 2, length - 2 ) );
+        return QByteArray( data, length );
+    }
+};
+
+/**
+ * Decodes @p column of the current row of @p query into @p value.
+ * @returns @c true if the value is NULL, @p value is default constructed in that case.
+ * @internal
+ */
+template <typename T>
+bool decode_value( const QSqlQuery &query, const SqlRawResult &raw, int column, T &value )
+{
+    if ( raw.isValid() ) {
+        int length = 0;
+        const char *data = raw.value( column, &length );
+        value = data ? value_decoder<T>::fromText( data, length ) : T();
+        return !data;
+    }
+    const QVariant v = query.value( column );
+    value = value_decoder<T>::fromVariant( v );
+    return v.isNull();
+}
+
+/**
+ * Metafunction appending the C++ type of @p Column to the std::tuple @p Tuple.
+ * @internal
+ */
+template <typename Tuple, typename Column> struct tuple_push_back;
+template <typename... T, typename Column>
+struct tuple_push_back<std::tuple<T...>, Column>
+{
+    typedef std::tuple<T..., typename Column::type> type;
+};
+
+/**
+ * The std::tuple holding one value of each column in @p ColumnList.
+ * @internal
+ */
+template <typename ColumnList>
+struct row_tuple : boost::mpl::fold<ColumnList, std::tuple<>, tuple_push_back<boost::mpl::placeholders::_1, boost::mpl::placeholders::_2> >
+{};
+
+/**
+ * Metafunction appending a std::vector of the C++ type of @p Column to the std::tuple @p Tuple.
+ * @internal
+ */
+template <typename Tuple, typename Column> struct tuple_push_back_vector;
+template <typename... T, typename Column>
+struct tuple_push_back_vector<std::tuple<T...>, Column>
+{
+    typedef std::tuple<T..., std::vector<typename Column::type> > type;
+};
+
+/**
+ * The std::tuple holding one std::vector for each column in @p ColumnList.
+ * @internal
+ */
+template <typename ColumnList>
+struct column_vectors : boost::mpl::fold<ColumnList, std::tuple<>, tuple_push_back_vector<boost::mpl::placeholders::_1, boost::mpl::placeholders::_2> >
+{};
+
+/**
+ * Position of @p Column in @p ColumnList.
+ * @internal
+ */
+template <typename ColumnList, typename Column>
+constexpr int column_index()
+{
+    typedef typename boost::mpl::find<ColumnList, Column>::type Pos;
+    static_assert( !boost::is_same<Pos, typename boost::mpl::end<ColumnList>::type>::value, "column is not selected" );
+    return boost::mpl::distance<typename boost::mpl::begin<ColumnList>::type, Pos>::value;
+}
+
+}
+
+/**
+ * Typed iteration over the rows of an executed query selecting the columns @p ColumnList.
+ * Each row is decoded into a std::tuple of the column types, with the decoder of every column chosen at compile time.
+ * With the QPSQL driver the values are decoded from the text sent by the server without going through QVariant.
+ * NULL values are decoded as default constructed values, use isNull() to tell them apart.
+ *
+ * @code
+ * for ( const auto &row : fetch( select( Person.id, Person.PersonSurname ).from( Person ) ) )
+ *     names.insert( std::get<0>( row ), std::get<1>( row ) );
+ * @endcode
+ */
+template <typename ColumnList>
+class Result
+{
+public:
+    typedef typename detail::row_tuple<ColumnList>::type Row;
+
+    /// Reads the rows of the already executed @p query.
+    explicit Result( const SqlQuery &query ) : m_query( query ), m_raw( m_query ) {}
+
+    Result( const Result &other ) : m_query( other.m_query ), m_raw( m_query ), m_row( other.m_row ) {}
+
+    /// Advances to the next row, returns @c false if there are no more rows.
+    bool next()
+    {
+        if ( !m_query.next() )
+            return false;
+        m_raw.update();
+        decode( std::make_index_sequence<boost::mpl::size<ColumnList>::value>() );
+        return true;
+    }
+
+    /// Returns the current row.
+    const Row& row() const { return m_row; }
+
+    /// Returns the value of @p Column in the current row.
+    template <typename Column>
+    const typename Column::type& value( const Column & = Column() ) const
+    {
+        return std::get<detail::column_index<ColumnList, Column>()>( m_row );
+    }
+
+    /// Returns @c true if @p Column is NULL in the current row.
+    template <typename Column>
+    bool isNull( const Column & = Column() ) const
+    {
+        return m_query.isNull( detail::column_index<ColumnList, Column>() );
+    }
+
+    /// Input iterator over the remaining rows, for range-based for loops.
+    class iterator : public std::iterator<std::input_iterator_tag, Row>
+    {
+    public:
+        iterator( Result *result = 0 ) : m_result( result ) {}
+        const Row& operator*() const { return m_result->row(); }
+        const Row* operator->() const { return &m_result->row(); }
+        iterator& operator++()
+        {
+            if ( !m_result->next() )
+                m_result = 0;
+            return *this;
+        }
+        bool operator==( const iterator &other ) const { return m_result == other.m_result; }
+        bool operator!=( const iterator &other ) const { return m_result != other.m_result; }
+    private:
+        Result *m_result;
+    };
+
+    iterator begin() { return next() ? iterator( this ) : iterator(); }
+    iterator end() { return iterator(); }
+
+private:
+    template <std::size_t... I>
+    void decode( std::index_sequence<I...> )
+    {
+        const bool unused[] = { false, detail::decode_value( m_query, m_raw, I, std::get<I>( m_row ) )... };
+        Q_UNUSED( unused );
+    }
+
+    Result& operator=( const Result& );
+
+    SqlQuery m_query;
+    SqlRawResult m_raw;
+    Row m_row;
+};
+
+/**
+ * Column-wise materialization of the result of a query selecting the columns @p ColumnList,
+ * into one contiguous std::vector per column plus a NULL bitmap per column.
+ * This suits aggregating over columns better than a list of rows, and avoids one allocation per row.
+ * Values are decoded the same way as by Result, NULL values are stored as default constructed values.
+ *
+ * @code
+ * ColumnarResult<...> columns = fetchColumns( select( Report.ts, Report.txt ).from( Report ) );
+ * const std::vector<QDateTime> &ts = columns.column( Report.ts );
+ * @endcode
+ */
+template <typename ColumnList>
+class ColumnarResult
+{
+public:
+    typedef typename detail::column_vectors<ColumnList>::type Columns;
+    static const int ColumnCount = boost::mpl::size<ColumnList>::value;
+
+    /**
+     * Reads all rows of the already executed @p query.
+     * Capacity is reserved up-front if the driver reports the size of the result set.
+     */
+    explicit ColumnarResult( const SqlQuery &query ) : m_rowCount( 0 )
+    {
+        SqlQuery q( query );
+        SqlRawResult raw( q );
+        if ( q.size() > 0 )
+            reserve( q.size(), std::make_index_sequence<ColumnCount>() );
+        while ( q.next() ) {
+            raw.update();
+            append( q, raw, std::make_index_sequence<ColumnCount>() );
+            ++m_rowCount;
+        }
+    }
+
+    /// Number of rows read.
+    int rowCount() const { return m_rowCount; }
+
+    /// Returns the values of @p Column, one per row.
+    template <typename Column>
+    const std::vector<typename Column::type>& column( const Column & = Column() ) const
+    {
+        return std::get<detail::column_index<ColumnList, Column>()>( m_columns );
+    }
+
+    /// Returns the NULL bitmap of @p Column, one entry per row.
+    template <typename Column>
+    const std::vector<bool>& nulls( const Column & = Column() ) const
+    {
+        return m_nulls[detail::column_index<ColumnList, Column>()];
+    }
+
+    /// Returns @c true if @p Column is NULL in row @p row.
+    template <typename Column>
+    bool isNull( int row, const Column & = Column() ) const
+    {
+        return nulls<Column>()[row];
+    }
+
+    /// Returns all column vectors.
+    const Columns& columns() const { return m_columns; }
+
+private:
+    template <std::size_t... I>
+    void reserve( int size, std::index_sequence<I...> )
+    {
+        const int unused[] = { 0, ( std::get<I>( m_columns ).reserve( size ), m_nulls[I].reserve( size ), 0 )... };
+        Q_UNUSED( unused );
+    }
+
+    template <std::size_t... I>
+    void append( const SqlQuery &query, const SqlRawResult &raw, std::index_sequence<I...> )
+    {
+        const int unused[] = { 0, ( appendValue( query, raw, I, std::get<I>( m_columns ) ), 0 )... };
+        Q_UNUSED( unused );
+    }
+
+    template <typename T>
+    void appendValue( const SqlQuery &query, const SqlRawResult &raw, int column, std::vector<T> &values )
+    {
+        T value;
+        m_nulls[column].push_back( detail::decode_value( query, raw, column, value ) );
+        values.push_back( std::move( value ) );
+    }
+
+    Columns m_columns;
+    std::array<std::vector<bool>, ColumnCount> m_nulls;
+    int m_rowCount;
+};
+
+/**
+ * Executes @p expr and returns its typed rows.
+ * @throws SqlException if executing the query failed
+ */
+template <typename ColumnList, typename TableT, typename JoinList, typename WhereExprT, typename GroupByList, typename SortList>
+Result<ColumnList> fetch( const SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> &expr )
+{
+    SqlQuery query = expr;
+    query.exec();
+    return Result<ColumnList>( query );
+}
+
+/**
+ * Executes @p expr and returns its result column-wise.
+ * @throws SqlException if executing the query failed
+ */
+template <typename ColumnList, typename TableT, typename JoinList, typename WhereExprT, typename GroupByList, typename SortList>
+ColumnarResult<ColumnList> fetchColumns( const SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> &expr )
+{
+    SqlQuery query = expr;
+    query.exec();
+    return ColumnarResult<ColumnList>( query );
+}
+
+}
+
+#endif
@@ -28,6 +28,7 @@
 #include <QUuid>
 
 #include <boost/mpl/bool.hpp>
+#include <boost/mpl/fold.hpp>
 #include <boost/mpl/if.hpp>
 #include <boost/mpl/push_back.hpp>
 #include <boost/mpl/vector.hpp>
@@ -100,6 +101,10 @@
 #define ONLY_USER_SELECT \
     typedef boost::mpl::true_ is_restricted;
 
+/** Convenience macro to maintain a ClosureTable for a recursive relation. Put after one of the RECURSIVE_RELATION macros. */
+#define CLOSURE_TABLE \
+    typedef boost::mpl::true_ has_closure_table;
+
 /** Convenience macro to create a table type. */
 #define TABLE( name, _EXPORT ) \
     struct name ## Type; \
@@ -138,7 +143,7 @@
 
 /** Convenience macro to create the schema declaration. */
 #define DECLARE_SCHEMA_MAKE_TYPE( r, unused, i, t ) BOOST_PP_COMMA_IF(i) BOOST_PP_CAT(t, Type)
-#define DECLARE_SCHEMA( name, seq ) typedef boost::mpl::vector<BOOST_PP_SEQ_FOR_EACH_I(DECLARE_SCHEMA_MAKE_TYPE, ~, seq)> name
+#define DECLARE_SCHEMA( name, seq ) typedef ::Sql::detail::with_closure_tables<boost::mpl::vector<BOOST_PP_SEQ_FOR_EACH_I(DECLARE_SCHEMA_MAKE_TYPE, ~, seq)> >::type name
 
 /** Convenience macro to create the schema definition. */
 #define DEFINE_SCHEMA_MAKE_DEF( r, unused, t ) BOOST_PP_CAT(t, Type) t;
@@ -217,6 +222,7 @@ struct Table
     typedef boost::mpl::true_ delete_rows;    //regular users can delete rows from it. _is_restricted takes precendece
     typedef boost::mpl::true_ update_rows;    //regular users can update rows from it. _is_restricted takes precendece
     typedef boost::mpl::true_ insert_rows;    //regular users can insert rows from it. _is_restricted takes precendece
+    typedef boost::mpl::false_ has_closure_table; //maintain a ClosureTable, only for recursive relations
 
     /**
      * Base class for SQL columns of table @p DerivedTable
@@ -361,6 +367,56 @@ struct UniqueRecursiveRelation : RecursiveRelation<DerivedTable, ColumnT>
     typedef boost::mpl::vector< UniqueConstraint< typename base_type::columns > > constraints;
 };
 
+/**
+ * Transitive closure of a recursive relation declared with CLOSURE_TABLE.
+ * Contains a row for every pair of a row and one of its direct or indirect parents, and the number of paths
+ * between them. It is kept up to date by triggers on the relation, see createTableTriggerStatements().
+ * DECLARE_SCHEMA adds it to the schema after the relation.
+ * @tparam RelationT The recursive relation table type.
+ */
+template <typename RelationT>
+struct ClosureTable : Table<ClosureTable<RelationT> >
+{
+    typedef Table<ClosureTable<RelationT> > base_type;
+    typedef typename RelationT::leftType::referenced_column referenced_column;
+    typedef boost::mpl::true_ is_restricted; // only written by the triggers
+    static QString sqlName() { return RelationT::sqlName() % QLatin1Literal( "_closure" ); }
+    static QString adminGroup() { return RelationT::adminGroup(); }
+    static QString userGroup() { return RelationT::userGroup(); }
+    struct descendantType : base_type::template ForeignKey<descendantType, referenced_column, NotNull | OnDeleteCascade> { SQL_NAME( "descendant" ) } descendant;
+    struct ancestorType : base_type::template ForeignKey<ancestorType, referenced_column, NotNull | OnDeleteCascade> { SQL_NAME( "ancestor" ) } ancestor;
+    struct pathsType : base_type::template Column<pathsType, int, NotNull> { SQL_NAME( "paths" ) } paths;
+    typedef boost::mpl::vector<descendantType, ancestorType, pathsType> columns;
+    // the unique indexes serve the lookups in both directions
+    typedef boost::mpl::vector< UniqueConstraint< boost::mpl::vector<descendantType, ancestorType> >,
+                                UniqueConstraint< boost::mpl::vector<ancestorType, descendantType> > > constraints;
+};
+
+namespace detail {
+
+/**
+ * Appends @p T to the table sequence @p Tables, followed by its ClosureTable if it has one.
+ * @internal
+ */
+template <typename Tables, typename T, bool HasClosureTable = T::has_closure_table::value>
+struct append_table : boost::mpl::push_back<Tables, T> {};
+
+template <typename Tables, typename T>
+struct append_table<Tables, T, true> : boost::mpl::push_back<typename boost::mpl::push_back<Tables, T>::type, ClosureTable<T> > {};
+
+struct append_table_op
+{
+    template <typename Tables, typename T> struct apply : append_table<Tables, T> {};
+};
+
+/**
+ * Metafunction adding the closure tables of the recursive relations in @p Tables, used by DECLARE_SCHEMA.
+ * @internal
+ */
+template <typename Tables>
+struct with_closure_tables : boost::mpl::fold<Tables, boost::mpl::vector<>, append_table_op> {};
+
+}
 
 }
 
@@ -30,8 +30,10 @@
 
 #include <boost/mpl/and.hpp>
 #include <boost/mpl/assert.hpp>
+#include <boost/mpl/at.hpp>
 #include <boost/mpl/bool.hpp>
 #include <boost/mpl/for_each.hpp>
+#include <boost/mpl/front.hpp>
 #include <boost/mpl/if.hpp>
 #include <boost/mpl/placeholders.hpp>
 #include <boost/mpl/size.hpp>
@@ -40,6 +42,8 @@
 #include <boost/utility/enable_if.hpp>
 #include <boost/static_assert.hpp>
 
+#include <utility>
+
 /**
  * @file SqlSelect.h
  * Select query expression templates.
@@ -64,6 +68,21 @@ struct columns_to_querybuilder
     SqlSelectQueryBuilder &m_qb;
 };
 
+/**
+ * MPL for_each accumulator to collect the unqualified column names of a table.
+ * @internal
+ */
+struct column_sql_names
+{
+    explicit column_sql_names( QStringList &names ) : m_names( names ) {}
+    template<typename C> void operator()( wrap<C> )
+    {
+        m_names.push_back( C::sqlName() );
+    }
+
+    QStringList &m_names;
+};
+
 /**
  * MPL for_each accumulator to add group by columnt to the query builder.
  * @internal
@@ -96,6 +115,304 @@ struct OrderInfo {
     QString column;
     Qt::SortOrder order;
 };
+
+/**
+ * Converts keyset pagination values to the types of the corresponding ORDER BY columns.
+ * @internal
+ */
+template <typename SortList, typename... Values, std::size_t... I>
+QVector<QVariant> page_values( std::index_sequence<I...>, const Values&... values )
+{
+    const QVariant converted[] = { QVariant(), QVariant::fromValue<typename boost::mpl::at_c<SortList, I>::type::type>( values )... };
+    QVector<QVariant> result;
+    result.reserve( sizeof...(Values) );
+    for ( std::size_t i = 1; i <= sizeof...(Values); ++i )
+        result.push_back( converted[i] );
+    return result;
+}
+
+/**
+ * SQL names of the aggregate functions.
+ * @internal
+ */
+struct CountFunction { static const char* sqlName() { return "COUNT"; } };
+struct SumFunction { static const char* sqlName() { return "SUM"; } };
+struct MinFunction { static const char* sqlName() { return "MIN"; } };
+struct MaxFunction { static const char* sqlName() { return "MAX"; } };
+struct AvgFunction { static const char* sqlName() { return "AVG"; } };
+
+/**
+ * Argument of an aggregate function, "*" for COUNT(*).
+ * @internal
+ */
+inline QString aggregate_argument( wrap<missing> ) { return QLatin1String( "*" ); }
+template <typename ColumnT>
+QString aggregate_argument( wrap<ColumnT> ) { return ColumnT::name(); }
+
+/**
+ * Metafunction for the C++ result type of SUM(), following the PostgreSQL result types.
+ * Not defined for types that can't be summed up.
+ * @internal
+ */
+template <typename T> struct sum_type;
+template <> struct sum_type<int> { typedef qlonglong type; };
+template <> struct sum_type<qlonglong> { typedef qlonglong type; };
+template <> struct sum_type<float> { typedef float type; };
+template <> struct sum_type<double> { typedef double type; };
+
+/**
+ * Cast appended to an aggregate function, if its PostgreSQL result type doesn't match the C++ one.
+ * SUM() over bigint is numeric, which the driver reads as double by default, so it is cast back to bigint;
+ * sums beyond the 64 bit range then fail with an error instead of silently losing precision.
+ * @internal
+ */
+template <typename Function, typename ColumnT>
+struct aggregate_cast
+{
+    static QString clause() { return QString(); }
+};
+template <typename ColumnT>
+struct aggregate_cast<SumFunction, ColumnT>
+{
+    static QString clause() { return boost::is_same<typename ColumnT::type, qlonglong>::value ? QString::fromLatin1( "::bigint" ) : QString(); }
+};
+
+/**
+ * Returns the fully qualified names of @p Columns, separated by commas.
+ * @internal
+ */
+template <typename... Columns>
+QString column_list()
+{
+    const QString names[] = { QString(), Columns::name()... };
+    QStringList list;
+    list.reserve( sizeof...(Columns) );
+    for ( std::size_t i = 1; i <= sizeof...(Columns); ++i )
+        list.push_back( names[i] );
+    return list.join( QLatin1String( ", " ) );
+}
+}
+
+/**
+ * An aggregate function over a column, to be used like a column in select(), orderBy() and having().
+ * @tparam Function tag type providing the SQL function name
+ * @tparam ColumnT the aggregated column, detail::missing for COUNT(*)
+ * @tparam ResultType C++ type of the result
+ */
+template <typename Function, typename ColumnT, typename ResultType>
+struct Aggregate
+{
+    /** C++ type of the result. */
+    typedef ResultType type;
+    /** For use in the condition operators, e.g. in having(). */
+    typedef boost::mpl::true_ is_column;
+    /** Aggregates other than COUNT are NULL if there are no rows. */
+    typedef boost::mpl::bool_<boost::is_same<Function, detail::CountFunction>::value> notNull;
+
+    static QString name() { return QLatin1String( Function::sqlName() ) + QLatin1Char( '(' ) + detail::aggregate_argument( detail::wrap<ColumnT>() ) + QLatin1Char( ')' ) + detail::aggregate_cast<Function, ColumnT>::clause(); }
+};
+
+/** COUNT(*), the number of rows. */
+inline Aggregate<detail::CountFunction, detail::missing, qlonglong> count()
+{
+    return Aggregate<detail::CountFunction, detail::missing, qlonglong>();
+}
+
+/** COUNT(column), the number of rows where @p column is not NULL. */
+template <typename ColumnT>
+Aggregate<detail::CountFunction, ColumnT, qlonglong> count( const ColumnT & )
+{
+    return Aggregate<detail::CountFunction, ColumnT, qlonglong>();
+}
+
+/** SUM(column), integers are summed up as 64 bit values, which is also the result type for bigint columns. */
+template <typename ColumnT>
+Aggregate<detail::SumFunction, ColumnT, typename detail::sum_type<typename ColumnT::type>::type> sum( const ColumnT & )
+{
+    return Aggregate<detail::SumFunction, ColumnT, typename detail::sum_type<typename ColumnT::type>::type>();
+}
+
+/** MIN(column) */
+template <typename ColumnT>
+Aggregate<detail::MinFunction, ColumnT, typename ColumnT::type> min( const ColumnT & )
+{
+    return Aggregate<detail::MinFunction, ColumnT, typename ColumnT::type>();
+}
+
+/** MAX(column) */
+template <typename ColumnT>
+Aggregate<detail::MaxFunction, ColumnT, typename ColumnT::type> max( const ColumnT & )
+{
+    return Aggregate<detail::MaxFunction, ColumnT, typename ColumnT::type>();
+}
+
+/** AVG(column), as double precision floating point value for any numeric column type. */
+template <typename ColumnT>
+Aggregate<detail::AvgFunction, ColumnT, double> avg( const ColumnT & )
+{
+    BOOST_STATIC_ASSERT(( sizeof( detail::sum_type<typename ColumnT::type> ) > 0 )); // only numeric columns
+    return Aggregate<detail::AvgFunction, ColumnT, double>();
+}
+
+/** PARTITION BY part of a window definition, see partitionBy(). */
+template <typename... Columns>
+struct WindowPartition
+{
+    static QString clause() { return QLatin1String( "PARTITION BY " ) + detail::column_list<Columns...>(); }
+};
+template <>
+struct WindowPartition<>
+{
+    static QString clause() { return QString(); }
+};
+
+/** ORDER BY part of a window definition, see orderBy(). */
+template <typename... Columns>
+struct WindowOrder
+{
+    static QString clause() { return QLatin1String( "ORDER BY " ) + detail::column_list<Columns...>(); }
+};
+template <>
+struct WindowOrder<>
+{
+    static QString clause() { return QString(); }
+};
+
+/** Descending sort order of a column in a window definition, see desc(). */
+template <typename ColumnT>
+struct Descending
+{
+    typedef typename ColumnT::type type;
+    static QString name() { return ColumnT::name() + QLatin1String( " DESC" ); }
+};
+
+/** Partitions the rows of a window function into groups of equal values of @p Columns. */
+template <typename... Columns>
+WindowPartition<Columns...> partitionBy( const Columns&... )
+{
+    return WindowPartition<Columns...>();
+}
+
+/** Orders the rows of a window function by @p Columns, use desc() for descending order. */
+template <typename... Columns>
+WindowOrder<Columns...> orderBy( const Columns&... )
+{
+    return WindowOrder<Columns...>();
+}
+
+/** Descending order of @p ColumnT in orderBy() of a window definition. */
+template <typename ColumnT>
+Descending<ColumnT> desc( const ColumnT & )
+{
+    return Descending<ColumnT>();
+}
+
+/**
+ * A window function with its window definition, to be used like a column in select(), orderBy() and qualify().
+ * @tparam Function the window function, providing the SQL expression and the result type
+ * @tparam Partition a WindowPartition
+ * @tparam Order a WindowOrder
+ */
+template <typename Function, typename Partition, typename Order>
+struct Window
+{
+    /** C++ type of the result. */
+    typedef typename Function::type type;
+    /** For use in the condition operators, e.g. in qualify(). */
+    typedef boost::mpl::true_ is_column;
+    typedef boost::mpl::false_ notNull;
+
+    static QString name()
+    {
+        const QString partition = Partition::clause();
+        const QString order = Order::clause();
+        QString window = partition;
+        if ( !partition.isEmpty() && !order.isEmpty() )
+            window += QLatin1Char( ' ' );
+        window += order;
+        return Function::expression() + QLatin1String( " OVER (" ) + window + QLatin1Char( ')' );
+    }
+};
+
+/**
+ * Base class for window functions.
+ * @tparam Derived CRTP
+ * @tparam ResultType C++ type of the result
+ */
+template <typename Derived, typename ResultType>
+struct WindowFunction
+{
+    typedef ResultType type;
+
+    /** ... OVER (PARTITION BY ... ORDER BY ...) */
+    template <typename... PartitionColumns, typename... OrderColumns>
+    Window<Derived, WindowPartition<PartitionColumns...>, WindowOrder<OrderColumns...> >
+    over( const WindowPartition<PartitionColumns...> &, const WindowOrder<OrderColumns...> & ) const
+    {
+        return Window<Derived, WindowPartition<PartitionColumns...>, WindowOrder<OrderColumns...> >();
+    }
+
+    /** ... OVER (PARTITION BY ...) */
+    template <typename... PartitionColumns>
+    Window<Derived, WindowPartition<PartitionColumns...>, WindowOrder<> > over( const WindowPartition<PartitionColumns...> & ) const
+    {
+        return Window<Derived, WindowPartition<PartitionColumns...>, WindowOrder<> >();
+    }
+
+    /** ... OVER (ORDER BY ...) */
+    template <typename... OrderColumns>
+    Window<Derived, WindowPartition<>, WindowOrder<OrderColumns...> > over( const WindowOrder<OrderColumns...> & ) const
+    {
+        return Window<Derived, WindowPartition<>, WindowOrder<OrderColumns...> >();
+    }
+};
+
+/** ROW_NUMBER(), numbering the rows of each partition starting at 1. */
+struct RowNumber : WindowFunction<RowNumber, qlonglong>
+{
+    static QString expression() { return QLatin1String( "ROW_NUMBER()" ); }
+};
+
+/** RANK(), like ROW_NUMBER() but equal rows get the same number, leaving gaps. */
+struct Rank : WindowFunction<Rank, qlonglong>
+{
+    static QString expression() { return QLatin1String( "RANK()" ); }
+};
+
+/** DENSE_RANK(), like RANK() without gaps. */
+struct DenseRank : WindowFunction<DenseRank, qlonglong>
+{
+    static QString expression() { return QLatin1String( "DENSE_RANK()" ); }
+};
+
+/** LAG(column, offset), the value of @p ColumnT @p Offset rows before the current one in the partition. */
+template <typename ColumnT, int Offset>
+struct Lag : WindowFunction<Lag<ColumnT, Offset>, typename ColumnT::type>
+{
+    static QString expression() { return QLatin1String( "LAG(" ) + ColumnT::name() + QLatin1String( ", " ) + QString::number( Offset ) + QLatin1Char( ')' ); }
+};
+
+/** LEAD(column, offset), the value of @p ColumnT @p Offset rows after the current one in the partition. */
+template <typename ColumnT, int Offset>
+struct Lead : WindowFunction<Lead<ColumnT, Offset>, typename ColumnT::type>
+{
+    static QString expression() { return QLatin1String( "LEAD(" ) + ColumnT::name() + QLatin1String( ", " ) + QString::number( Offset ) + QLatin1Char( ')' ); }
+};
+
+inline RowNumber rowNumber() { return RowNumber(); }
+inline Rank rank() { return Rank(); }
+inline DenseRank denseRank() { return DenseRank(); }
+
+template <int Offset = 1, typename ColumnT>
+Lag<ColumnT, Offset> lag( const ColumnT & )
+{
+    return Lag<ColumnT, Offset>();
+}
+
+template <int Offset = 1, typename ColumnT>
+Lead<ColumnT, Offset> lead( const ColumnT & )
+{
+    return Lead<ColumnT, Offset>();
 }
 
 
@@ -129,7 +446,7 @@ struct SelectExpr
     /**
      * Empty ctor.
      */
-    SelectExpr() {}
+    SelectExpr() : pageLength( -1 ) {}
 
     /**
      * "Copy" ctor.
@@ -139,8 +456,13 @@ struct SelectExpr
     SelectExpr( const SelectExpr<OtherColumnList, OtherTableT, OtherJoinList, OtherWhereExprT, OtherGroupByList, OtherSortList> &other )
     {
         whereCondition = other.whereCondition;
+        havingCondition = other.havingCondition;
+        qualifyCondition = other.qualifyCondition;
+        commonTableExpressions = other.commonTableExpressions;
         joinInfos = other.joinInfos;
         orderInfos = other.orderInfos;
+        pageValues = other.pageValues;
+        pageLength = other.pageLength;
     }
 
     /**
@@ -215,6 +537,70 @@ struct SelectExpr
     #undef GROUP_BY_IMPL
     #undef CONST_REF
 
+    /**
+     * Create the HAVING part of a SELECT statement, to filter groups by aggregates, e.g. having( count() > 1 ).
+     * @tparam H The condition expression
+     */
+    template <typename H>
+    SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> having( const H& cond )
+    {
+        BOOST_MPL_ASSERT(( boost::mpl::not_<boost::is_same<TableT, detail::missing> > )); // FROM comes before HAVING
+        Q_ASSERT( !havingCondition.hasSubConditions() ); // only one HAVING
+        SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> s( *this );
+        detail::assign_condition( s.havingCondition, cond );
+        return s;
+    }
+
+    /**
+     * Filter rows on the results of window functions, e.g. qualify( rowNumber().over( partitionBy( ... ), orderBy( ... ) ) <= 3 ).
+     * The window functions don't need to be selected. See SqlSelectQueryBuilder::qualifyCondition().
+     * @tparam Q The condition expression
+     */
+    template <typename Q>
+    SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> qualify( const Q& cond )
+    {
+        BOOST_MPL_ASSERT(( boost::mpl::not_<boost::is_same<TableT, detail::missing> > )); // FROM comes before QUALIFY
+        Q_ASSERT( !qualifyCondition.hasSubConditions() ); // only one QUALIFY
+        SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> s( *this );
+        detail::assign_condition( s.qualifyCondition, cond );
+        return s;
+    }
+
+    /**
+     * Create a WITH part, making the result of @p query available as table @p CteT in this query.
+     * @tparam CteT A table type declaring the name and the columns of the result, it doesn't need to exist in the database.
+     */
+    template <typename CteT, typename C, typename T, typename J, typename W, typename G, typename S>
+    SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> with( const CteT &, const SelectExpr<C, T, J, W, G, S> &query )
+    {
+        BOOST_STATIC_ASSERT(( boost::mpl::size<C>::value == boost::mpl::size<typename CteT::columns>::value )); // one selected column per table column
+        SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> s( *this );
+        QStringList columns;
+        boost::mpl::for_each<typename CteT::columns, detail::wrap<boost::mpl::placeholders::_1> >( detail::column_sql_names( columns ) );
+        SqlSelectQueryBuilder::CommonTableExpression cte;
+        cte.name = CteT::sqlName();
+        cte.columns = columns;
+        cte.query = QSharedPointer<const SqlSelectQueryBuilder>( new SqlSelectQueryBuilder( query.queryBuilder() ) );
+        s.commonTableExpressions.push_back( cte );
+        return s;
+    }
+
+    /**
+     * Create a WITH RECURSIVE part, the rows of @p CteT are the results of @p initialQuery and of @p recursiveQuery,
+     * which joins @p CteT to compute further rows from the ones found so far.
+     * See SqlSelectQueryBuilder::addRecursiveCommonTableExpression().
+     */
+    template <typename CteT, typename C1, typename T1, typename J1, typename W1, typename G1, typename S1,
+                             typename C2, typename T2, typename J2, typename W2, typename G2, typename S2>
+    SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> withRecursive( const CteT &table,
+        const SelectExpr<C1, T1, J1, W1, G1, S1> &initialQuery, const SelectExpr<C2, T2, J2, W2, G2, S2> &recursiveQuery )
+    {
+        BOOST_STATIC_ASSERT(( boost::mpl::size<C1>::value == boost::mpl::size<C2>::value )); // both parts return the same columns
+        SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> s( with( table, initialQuery ) );
+        s.commonTableExpressions.last().recursiveQuery = QSharedPointer<const SqlSelectQueryBuilder>( new SqlSelectQueryBuilder( recursiveQuery.queryBuilder() ) );
+        return s;
+    }
+
 
     /**
      * Add ORDER BY expressions.
@@ -273,6 +659,21 @@ struct SelectExpr
     #undef CONST_REF_AND_ORDER
     #undef RECORD_ORDER_INFO
 
+    /**
+     * Keyset pagination, selects the @p length rows following the row with the ORDER BY column values @p lastValues.
+     * Pass no values for the first page. See SqlSelectQueryBuilder::setPageAfter().
+     */
+    template <typename... Values>
+    SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> pageAfter( uint length, const Values&... lastValues )
+    {
+        BOOST_STATIC_ASSERT(( boost::mpl::size<SortList>::value > 0 )); /* ORDER BY comes before pagination */
+        static_assert( sizeof...(Values) == 0 || sizeof...(Values) == boost::mpl::size<SortList>::value, "one value per ORDER BY column is needed" );
+        SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> s( *this );
+        s.pageValues = detail::page_values<SortList>( std::index_sequence_for<Values...>(), lastValues... );
+        s.pageLength = length;
+        return s;
+    }
+
     /**
      * @internal
      * for unit testing access only
@@ -280,23 +681,96 @@ struct SelectExpr
     SqlSelectQueryBuilder queryBuilder() const
     {
         SqlSelectQueryBuilder qb;
+        foreach ( const SqlSelectQueryBuilder::CommonTableExpression &cte, commonTableExpressions )
+            qb.addCommonTableExpression( cte );
         boost::mpl::for_each<ColumnList, detail::wrap<boost::mpl::placeholders::_1> >( detail::columns_to_querybuilder( qb ) );
         qb.setTable<TableT>();
         foreach ( const detail::JoinInfo& ji, joinInfos )
             qb.addJoin( ji.type, ji.table, ji.condition );
         qb.whereCondition() = whereCondition;
         boost::mpl::for_each<GroupByList, detail::wrap<boost::mpl::placeholders::_1> >( detail::groupby_to_querybuilder( qb ) );
+        qb.havingCondition() = havingCondition;
+        qb.qualifyCondition() = qualifyCondition;
         foreach ( const detail::OrderInfo &oi, orderInfos )
             qb.addSortColumn( oi.column, oi.order );
+        if ( pageLength >= 0 )
+            qb.setPageAfter( pageValues, pageLength );
         return qb;
     }
 
+    /**
+     * @internal
+     * Returns the statement text for this expression type, rendered once per sort order combination
+     * and kind of page (none, first, following), or 0 if the text depends on more than the type
+     * (placeholder names, number of IN values, sub-queries, HAVING and QUALIFY conditions, WITH parts).
+     */
+    const detail::StaticStatement* staticStatement() const
+    {
+        static const int SortVariants = 1 << boost::mpl::size<SortList>::value;
+        typedef detail::static_statement<SelectExpr, SortVariants * 3> Statements;
+        if ( whereCondition.hasPlaceholders() || whereCondition.hasSubQueries() || havingCondition.hasSubConditions() || qualifyCondition.hasSubConditions() )
+            return 0;
+        if ( !commonTableExpressions.isEmpty() )
+            return 0;
+        bool hasValueLists = whereCondition.hasValueLists();
+        foreach ( const detail::JoinInfo& ji, joinInfos ) {
+            if ( ji.condition.hasPlaceholders() || ji.condition.hasSubQueries() )
+                return 0;
+            hasValueLists = hasValueLists || ji.condition.hasValueLists();
+        }
+        if ( hasValueLists && !SqlQueryBuilderBase::supportsArrayBinding( QSqlDatabase::database() ) )
+            return 0;
+        int variant = 0;
+        for ( int i = 0; i < orderInfos.size(); ++i ) {
+            if ( orderInfos.at( i ).order == Qt::DescendingOrder )
+                variant |= 1 << i;
+        }
+        if ( pageLength >= 0 )
+            variant += SortVariants * ( pageValues.isEmpty() ? 1 : 2 );
+        const detail::StaticStatement *stmt = Statements::get( variant );
+        if ( stmt )
+            return stmt;
+
+        detail::StaticStatement *rendered = new detail::StaticStatement;
+        rendered->text = queryBuilder().statement();
+        rendered->valueCount = bindValues().size();
+        return Statements::store( variant, rendered );
+    }
+
+    /**
+     * @internal
+     * Returns the values to bind, in the order of the placeholders in staticStatement().
+     */
+    QVector<QVariant> bindValues() const
+    {
+        QVector<QVariant> values;
+        foreach ( const detail::JoinInfo& ji, joinInfos )
+            ji.condition.collectBindValues( values );
+        whereCondition.collectBindValues( values );
+        // keep in sync with SqlSelectQueryBuilder::collectBindValues()
+        if ( !qualifyCondition.hasSubConditions() )
+            values += pageValues;
+        havingCondition.collectBindValues( values );
+        if ( qualifyCondition.hasSubConditions() ) {
+            qualifyCondition.collectBindValues( values );
+            values += pageValues;
+        }
+        if ( pageLength >= 0 )
+            values.push_back( static_cast<qlonglong>( pageLength ) );
+        return values;
+    }
+
     /**
      * Returns a prepared QSqlQuery ready for execution.
      */
     operator SqlQuery() const
     {
-        return queryBuilder().query();
+        const detail::StaticStatement *stmt = staticStatement();
+        if ( !stmt )
+            return queryBuilder().query();
+        const QVector<QVariant> values = bindValues();
+        Q_ASSERT( values.size() == stmt->valueCount );
+        return SqlQueryBuilderBase::prepareStatement( stmt->text, values );
     }
 
     /**
@@ -310,8 +784,13 @@ struct SelectExpr
     }
 
     SqlCondition whereCondition;
+    SqlCondition havingCondition;
+    SqlCondition qualifyCondition;
+    QVector<SqlSelectQueryBuilder::CommonTableExpression> commonTableExpressions;
     QVector<detail::JoinInfo> joinInfos;
     QVector<detail::OrderInfo> orderInfos;
+    QVector<QVariant> pageValues;
+    int pageLength;
 };
 
 
@@ -337,6 +816,154 @@ BOOST_PP_REPEAT_FROM_TO(1, SQL_SELECT_MAX_SIZE, SELECT_IMPL, ~)
 #undef SELECT_IMPL
 #undef CONST_REF
 
+/**
+ * Creates an EXISTS condition, true if @p subQuery returns any rows.
+ * The sub-query can refer to columns of the outer query, e.g. in its WHERE condition.
+ */
+template <typename ColumnList, typename TableT, typename JoinList, typename WhereExprT, typename GroupByList, typename SortList>
+ConditionSubQueryLeaf<detail::missing, SqlCondition::Exists, SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> >
+exists( const SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> &subQuery )
+{
+    ConditionSubQueryLeaf<detail::missing, SqlCondition::Exists, SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> > c;
+    c.condition.addExistsCondition( SqlCondition::Exists, subQuery.queryBuilder() );
+    return c;
+}
+
+/**
+ * Creates a NOT EXISTS condition, true if @p subQuery returns no rows.
+ */
+template <typename ColumnList, typename TableT, typename JoinList, typename WhereExprT, typename GroupByList, typename SortList>
+ConditionSubQueryLeaf<detail::missing, SqlCondition::NotExists, SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> >
+notExists( const SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> &subQuery )
+{
+    ConditionSubQueryLeaf<detail::missing, SqlCondition::NotExists, SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> > c;
+    c.condition.addExistsCondition( SqlCondition::NotExists, subQuery.queryBuilder() );
+    return c;
+}
+
+/**
+ * Creates an IN condition, matching any of the values returned by @p subQuery.
+ * @tparam ColumnT The column type, @p subQuery has to select a single column of the same type.
+ */
+template <typename ColumnT, typename ColumnList, typename TableT, typename JoinList, typename WhereExprT, typename GroupByList, typename SortList>
+ConditionSubQueryLeaf<ColumnT, SqlCondition::In, SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> >
+in( const ColumnT &, const SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> &subQuery )
+{
+    BOOST_STATIC_ASSERT(( boost::mpl::size<ColumnList>::value == 1 )); // the sub-query has to select exactly one column
+    BOOST_MPL_ASSERT(( boost::is_same<typename ColumnT::type, typename boost::mpl::front<ColumnList>::type::type> )); // only compare columns of the same type
+    ConditionSubQueryLeaf<ColumnT, SqlCondition::In, SelectExpr<ColumnList, TableT, JoinList, WhereExprT, GroupByList, SortList> > c;
+    c.condition.addSubQueryCondition( ColumnT::name(), SqlCondition::In, subQuery.queryBuilder() );
+    return c;
+}
+
+/**
+ * The rows reachable through a recursive relation from a start row, as computed by ancestors() and descendants() without ClosureTable.
+ * @tparam RelationT A RECURSIVE_RELATION or UNIQUE_RECURSIVE_RELATION table, a row in it makes its right column a parent of its left one.
+ * @tparam Ancestors @c true to walk from children to parents, @c false for the other direction.
+ */
+template <typename RelationT, bool Ancestors>
+struct Traversal : Table<Traversal<RelationT, Ancestors> >
+{
+    typedef Table<Traversal<RelationT, Ancestors> > base_type;
+    static QString sqlName() { return QLatin1String( Ancestors ? "sqlate_ancestors" : "sqlate_descendants" ); }
+    /// A reached row of the related table.
+    struct idType : base_type::template Column<idType, typename RelationT::leftType::type, NotNull> { SQL_NAME( "id" ) } id;
+    /// The number of relation rows between the start row and this one, 1 for direct parents or children.
+    struct depthType : base_type::template Column<depthType, int, NotNull> { SQL_NAME( "depth" ) } depth;
+    typedef boost::mpl::vector<idType, depthType> columns;
+};
+
+namespace detail {
+
+/**
+ * Builds the WITH RECURSIVE query for ancestors() and descendants(), walking from @p FromColumn to @p ToColumn.
+ * @internal
+ */
+template <typename TraversalT, typename FromColumn, typename ToColumn>
+SelectExpr<boost::mpl::vector<typename TraversalT::idType>, TraversalT, boost::mpl::vector<>, detail::missing>
+traversal( const typename TraversalT::idType::type &start )
+{
+    typedef typename FromColumn::table RelationT;
+    SqlSelectQueryBuilder initialQuery;
+    initialQuery.addColumn( ToColumn::name() );
+    initialQuery.addColumnExpression( QLatin1String( "1" ) );
+    initialQuery.setTable<RelationT>();
+    initialQuery.whereCondition().addValueCondition( FromColumn::name(), SqlCondition::Equals, QVariant::fromValue( start ) );
+
+    SqlSelectQueryBuilder recursiveQuery;
+    recursiveQuery.addColumn( ToColumn::name() );
+    recursiveQuery.addColumnExpression( TraversalT::depthType::name() + QLatin1String( " + 1" ) );
+    recursiveQuery.setTable<RelationT>();
+    recursiveQuery.addJoin( SqlSelectQueryBuilder::InnerJoin, TraversalT::sqlName(), FromColumn::name(), TraversalT::idType::name() );
+
+    QStringList columns;
+    boost::mpl::for_each<typename TraversalT::columns, detail::wrap<boost::mpl::placeholders::_1> >( detail::column_sql_names( columns ) );
+    SqlSelectQueryBuilder::CommonTableExpression cte;
+    cte.name = TraversalT::sqlName();
+    cte.columns = columns;
+    cte.query = QSharedPointer<const SqlSelectQueryBuilder>( new SqlSelectQueryBuilder( initialQuery ) );
+    cte.recursiveQuery = QSharedPointer<const SqlSelectQueryBuilder>( new SqlSelectQueryBuilder( recursiveQuery ) );
+
+    SelectExpr<boost::mpl::vector<typename TraversalT::idType>, TraversalT, boost::mpl::vector<>, detail::missing> expr;
+    expr.commonTableExpressions.push_back( cte );
+    return expr;
+}
+
+/**
+ * Implementation of ancestors() and descendants() for relations without ClosureTable: a recursive walk over the relation.
+ * @internal
+ */
+template <typename RelationT, bool Ancestors, bool HasClosureTable = RelationT::has_closure_table::value>
+struct traversal_select
+{
+    typedef Traversal<RelationT, Ancestors> table;
+    typedef typename boost::mpl::if_c<Ancestors, typename RelationT::leftType, typename RelationT::rightType>::type from_column;
+    typedef typename boost::mpl::if_c<Ancestors, typename RelationT::rightType, typename RelationT::leftType>::type to_column;
+    typedef SelectExpr<boost::mpl::vector<typename table::idType>, table, boost::mpl::vector<>, detail::missing> type;
+    static type create( const typename RelationT::leftType::type &start ) { return traversal<table, from_column, to_column>( start ); }
+};
+
+/**
+ * Implementation of ancestors() and descendants() for relations with ClosureTable: a single indexed lookup.
+ * @internal
+ */
+template <typename RelationT, bool Ancestors>
+struct traversal_select<RelationT, Ancestors, true>
+{
+    typedef ClosureTable<RelationT> table;
+    typedef typename boost::mpl::if_c<Ancestors, typename table::descendantType, typename table::ancestorType>::type from_column;
+    typedef typename boost::mpl::if_c<Ancestors, typename table::ancestorType, typename table::descendantType>::type to_column;
+    typedef SelectExpr<boost::mpl::vector<to_column>, table, boost::mpl::vector<>,
+                       ConditionExpr<boost::mpl::vector<ConditionValueLeaf<from_column, SqlCondition::Equals, typename from_column::type> >, SqlCondition::And> > type;
+    static type create( const typename RelationT::leftType::type &start ) { return select( to_column() ).from( table() ).where( from_column() == start ); }
+};
+
+}
+
+/**
+ * Selects the ids of all direct and indirect parents of @p start in a recursive relation, in a single query.
+ * Use it as sub-query to get the related rows, e.g. where( in( Person.id, ancestors( PersonBossRelation, bossId ) ) ).
+ * Relations declared with CLOSURE_TABLE are looked up in their ClosureTable, others are walked with WITH RECURSIVE,
+ * which requires the relation to be free of cycles.
+ */
+template <typename RelationT>
+typename detail::traversal_select<RelationT, true>::type
+ancestors( const RelationT &, const typename RelationT::leftType::type &start )
+{
+    return detail::traversal_select<RelationT, true>::create( start );
+}
+
+/**
+ * Selects the ids of all direct and indirect children of @p start in a recursive relation, in a single query.
+ * @see ancestors()
+ */
+template <typename RelationT>
+typename detail::traversal_select<RelationT, false>::type
+descendants( const RelationT &, const typename RelationT::leftType::type &start )
+{
+    return detail::traversal_select<RelationT, false>::create( start );
+}
+
 //Operators to fix compilation under MSVC10, that picks up the wrong overloads
 
 template <typename T> typename boost::enable_if<boost::is_enum<T>, bool>::type
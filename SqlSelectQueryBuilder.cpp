@@ -31,7 +31,8 @@ SqlSelectQueryBuilder::SqlSelectQueryBuilder(const QSqlDatabase& db) :
     m_lockNoWait( false ),
     m_distinct( false ),
     m_limitOffset( -1 ),
-    m_limitLength( -1 )
+    m_limitLength( -1 ),
+    m_pageLength( -1 )
 {
 }
 
@@ -66,6 +67,33 @@ void SqlSelectQueryBuilder::addJoin(SqlSelectQueryBuilder::JoinType joinType, co
     addJoin( joinType, table, c );
 }
 
+void SqlSelectQueryBuilder::addCommonTableExpression(const QString& name, const SqlSelectQueryBuilder& query, const QStringList& columns)
+{
+    CommonTableExpression cte;
+    cte.name = name;
+    cte.columns = columns;
+    cte.query = QSharedPointer<const SqlSelectQueryBuilder>( new SqlSelectQueryBuilder( query ) );
+    addCommonTableExpression( cte );
+}
+
+void SqlSelectQueryBuilder::addRecursiveCommonTableExpression(const QString& name, const QStringList& columns,
+                                                              const SqlSelectQueryBuilder& initialQuery, const SqlSelectQueryBuilder& recursiveQuery)
+{
+    CommonTableExpression cte;
+    cte.name = name;
+    cte.columns = columns;
+    cte.query = QSharedPointer<const SqlSelectQueryBuilder>( new SqlSelectQueryBuilder( initialQuery ) );
+    cte.recursiveQuery = QSharedPointer<const SqlSelectQueryBuilder>( new SqlSelectQueryBuilder( recursiveQuery ) );
+    addCommonTableExpression( cte );
+}
+
+void SqlSelectQueryBuilder::addCommonTableExpression(const SqlSelectQueryBuilder::CommonTableExpression& expression)
+{
+    Q_ASSERT( !expression.name.isEmpty() );
+    Q_ASSERT( expression.query );
+    m_commonTableExpressions.push_back( expression );
+}
+
 void SqlSelectQueryBuilder::addSortColumn(const QString& column, Qt::SortOrder sortOrder)
 {
     m_sortColumns.push_back( qMakePair( column, sortOrder ) );
@@ -80,6 +108,7 @@ void SqlSelectQueryBuilder::removeSortColumn(const QString& column)
             m_sortColumns.erase(it);
             break;
         }
+        ++it;
     }
 }
 
@@ -98,6 +127,16 @@ void SqlSelectQueryBuilder::addGroupColumn(const QString& column)
     m_groupColumns.push_back( column );
 }
 
+SqlCondition& SqlSelectQueryBuilder::havingCondition()
+{
+    return m_havingCondition;
+}
+
+SqlCondition& SqlSelectQueryBuilder::qualifyCondition()
+{
+    return m_qualifyCondition;
+}
+
 static QString joinTypeToString( SqlSelectQueryBuilder::JoinType j )
 {
     switch ( j ) {
@@ -111,45 +150,128 @@ static QString joinTypeToString( SqlSelectQueryBuilder::JoinType j )
     return QString();
 }
 
-SqlQuery& SqlSelectQueryBuilder::query()
+void SqlSelectQueryBuilder::assembleQuery()
 {
-    if ( !m_assembled ) {
-        m_queryString = toString();
-        m_assembled = true;
-        prepareQuery();
+    m_queryString = toString();
+}
+
+SqlQueryBuilderBase::Fingerprint SqlSelectQueryBuilder::fingerprint() const
+{
+    Fingerprint fp;
+    fp << QLatin1String( "SELECT" ) << m_bindedValuesOffset << m_commonTableExpressions.size();
+    foreach ( const CommonTableExpression &cte, m_commonTableExpressions ) {
+        fp << cte.name << cte.columns.join( QLatin1String( "," ) ) << cte.query->fingerprint();
+        if ( cte.recursiveQuery )
+            fp << 1 << cte.recursiveQuery->fingerprint();
+        else
+            fp << 0;
+    }
+    fp << m_distinct << m_distinctOn << m_columns.size();
+    typedef QPair<QString, QString> StringPair;
+    foreach ( const StringPair &col, m_columns )
+        fp << col.first << col.second;
+    fp << m_table << m_joins.size();
+    foreach ( const JoinInfo &j, m_joins ) {
+        fp << j.type << j.table;
+        hashCondition( fp, j.condition );
     }
-    return m_query;
+    hashCondition( fp, m_whereCondition );
+    fp << m_groupColumns.size();
+    foreach ( const QString &col, m_groupColumns )
+        fp << col;
+    hashCondition( fp, m_havingCondition );
+    hashCondition( fp, m_qualifyCondition );
+    fp << m_sortColumns.size();
+    typedef QPair<QString, Qt::SortOrder> StringOrderPair;
+    foreach ( const StringOrderPair &sortCol, m_sortColumns )
+        fp << sortCol.first << sortCol.second;
+    fp << m_lockTablesForUpdate.size();
+    foreach ( const QString &table, m_lockTablesForUpdate )
+        fp << table;
+    fp << m_lockNoWait << ( m_limitOffset != static_cast<uint>( -1 ) );
+    fp << ( m_pageLength >= 0 ) << m_pageValues.size();
+    foreach ( const QVariant &value, m_pageValues )
+        fp << value;
+    return fp;
 }
 
-void SqlSelectQueryBuilder::prepareQuery()
+void SqlSelectQueryBuilder::collectBindValues()
 {
-#ifndef QUERYBUILDER_UNITTEST
-    m_query = SqlQueryBuilderBase::prepareQuery( m_queryString );
-    for ( int i = 0; i < m_bindValues.size(); ++i ) {
-        const QVariant value = m_bindValues.at( i );
-        bindValue( i, value );
+    // same order as toString() registers them
+    m_bindValues.clear();
+    foreach ( const CommonTableExpression &cte, m_commonTableExpressions ) {
+        SqlSelectQueryBuilder query( *cte.query );
+        query.collectBindValues();
+        m_bindValues += query.m_bindValues;
+        if ( cte.recursiveQuery ) {
+            SqlSelectQueryBuilder recursiveQuery( *cte.recursiveQuery );
+            recursiveQuery.collectBindValues();
+            m_bindValues += recursiveQuery.m_bindValues;
+        }
     }
-#endif
+    foreach ( const JoinInfo &j, m_joins )
+        j.condition.collectBindValues( m_bindValues, valueListBinding() );
+    m_whereCondition.collectBindValues( m_bindValues, valueListBinding() );
+    const bool qualify = m_qualifyCondition.hasSubConditions();
+    if ( !qualify )
+        m_bindValues += m_pageValues;
+    m_havingCondition.collectBindValues( m_bindValues, valueListBinding() );
+    if ( qualify ) {
+        m_qualifyCondition.collectBindValues( m_bindValues, valueListBinding() );
+        m_bindValues += m_pageValues;
+    }
+    if ( m_limitOffset != static_cast<uint>( -1 ) )
+        m_bindValues << static_cast<qlonglong>( m_limitOffset ) << static_cast<qlonglong>( m_limitLength );
+    if ( m_pageLength >= 0 )
+        m_bindValues << static_cast<qlonglong>( m_pageLength );
 }
 
 QString SqlSelectQueryBuilder::toString()
 {
+    m_bindValues.clear();
+
+    // with a QUALIFY condition the query up to HAVING becomes a derived table,
+    // the filtering, sorting and paging happen outside, on the aliases of its columns
+    const bool qualify = m_qualifyCondition.hasSubConditions();
+    Q_ASSERT( !qualify || m_lockTablesForUpdate.isEmpty() );
+    QStringList innerColumns;
+    QVector<QPair<QString, Qt::SortOrder> > sortColumns = m_sortColumns;
+    SqlCondition qualifyCondition;
+    typedef QPair<QString, QString> StringPair;
+    if ( qualify ) {
+        // the outer query only sees the aliased columns of the derived table
+        if ( !m_distinctOn.isEmpty() ) {
+            throw SqlException( QSqlError( QLatin1String( "DISTINCT ON can't be combined with a QUALIFY condition" ),
+                                           QString(), QSqlError::StatementError ) );
+        }
+        foreach ( const StringPair &col, m_columns ) {
+            if ( col.first == QLatin1String( "*" ) || col.first.endsWith( QLatin1String( ".*" ) ) ) {
+                throw SqlException( QSqlError( QLatin1String( "Selecting all columns can't be combined with a QUALIFY condition" ),
+                                               QString(), QSqlError::StatementError ) );
+            }
+            columnAlias( col.first, innerColumns );
+        }
+        qualifyCondition = aliasedCondition( m_qualifyCondition, innerColumns );
+        for ( int i = 0; i < sortColumns.size(); ++i )
+            sortColumns[i].first = columnAlias( sortColumns.at( i ).first, innerColumns );
+    }
 
     QString queryString;
 
     QStringList cols;
-    typedef QPair<QString, QString> StringPair;
     foreach ( const StringPair &col, m_columns ) {
+        const QString column = qualify ? columnAlias( col.first, innerColumns ) : col.first;
         if ( col.second.isEmpty() )
-            cols.push_back( col.first );
+            cols.push_back( column );
         else {
             QString quotedAs = col.second;
             quotedAs.replace( QLatin1String( "\"" ), QLatin1String( "\\\"" ) );
-            cols.push_back( col.first + QLatin1String( " AS \"" ) + quotedAs + QLatin1Char( '"' ) );
+            cols.push_back( column + QLatin1String( " AS \"" ) + quotedAs + QLatin1Char( '"' ) );
         }
     }
 
-    queryString = QLatin1String( "SELECT " );
+    queryString = withClause();
+    queryString += QLatin1String( "SELECT " );
     if(m_distinct)
         queryString += QLatin1String( "DISTINCT " );
     if (!m_distinctOn.isEmpty()) {
@@ -157,6 +279,13 @@ QString SqlSelectQueryBuilder::toString()
         queryString += QLatin1Literal( "DISTINCT ON(" ) % m_distinctOn % QLatin1Literal( ") " );
     }
     queryString += cols.join( QLatin1String( ", " ) );
+    if ( qualify ) {
+        QStringList aliasedColumns;
+        foreach ( const QString &column, innerColumns )
+            aliasedColumns.push_back( column + QLatin1String( " AS " ) + columnAlias( column, innerColumns ) );
+        queryString += QLatin1String( " FROM (SELECT " );
+        queryString += aliasedColumns.join( QLatin1String( ", " ) );
+    }
     if ( !m_table.isEmpty() ) {
         queryString += QLatin1String( " FROM " );
         queryString += m_table;
@@ -169,19 +298,41 @@ QString SqlSelectQueryBuilder::toString()
     }
     if ( m_whereCondition.hasSubConditions() ) {
         queryString += QLatin1String( " WHERE " );
-        queryString += conditionToString( m_whereCondition );
+        if ( m_pageValues.isEmpty() || qualify ) {
+            queryString += conditionToString( m_whereCondition );
+        } else {
+            queryString += QLatin1Char( '(' ) + conditionToString( m_whereCondition ) + QLatin1String( ") AND " );
+            queryString += keysetCondition( sortColumns );
+        }
+    } else if ( !m_pageValues.isEmpty() && !qualify ) {
+        queryString += QLatin1String( " WHERE " );
+        queryString += keysetCondition( sortColumns );
     }
 
     if ( !m_groupColumns.isEmpty() ) {
         queryString += QLatin1String( " GROUP BY " );
         queryString += m_groupColumns.join( QLatin1String( ", " ) );
     }
+    if ( m_havingCondition.hasSubConditions() ) {
+        queryString += QLatin1String( " HAVING " );
+        queryString += conditionToString( m_havingCondition );
+    }
 
-    if ( !m_sortColumns.isEmpty() ) {
+    if ( qualify ) {
+        queryString += QLatin1String( ") AS sqlate_window WHERE " );
+        if ( m_pageValues.isEmpty() ) {
+            queryString += conditionToString( qualifyCondition );
+        } else {
+            queryString += QLatin1Char( '(' ) + conditionToString( qualifyCondition ) + QLatin1String( ") AND " );
+            queryString += keysetCondition( sortColumns );
+        }
+    }
+
+    if ( !sortColumns.isEmpty() ) {
         queryString += QLatin1String( " ORDER BY " );
         QStringList sortCols;
         typedef QPair<QString, Qt::SortOrder> StringOrderPair;
-        foreach ( const StringOrderPair &sortCol, m_sortColumns )
+        foreach ( const StringOrderPair &sortCol, sortColumns )
             sortCols.push_back( sortCol.first + orderToString( sortCol.second ) );
         queryString += sortCols.join( QLatin1String( ", " ) );
     }
@@ -192,13 +343,76 @@ QString SqlSelectQueryBuilder::toString()
         if ( m_lockNoWait )
             queryString += QLatin1String( " NOWAIT" );
     }
-    if ( m_limitOffset != -1 ) {
-        queryString += QString::fromLatin1( " OFFSET %1 LIMIT %2" ).arg( m_limitOffset ).arg( m_limitLength );
+    // bound rather than inlined, so that paging doesn't produce a new statement per page
+    if ( m_limitOffset != static_cast<uint>( -1 ) ) {
+        queryString += QLatin1String( " OFFSET " ) + registerBindValue( static_cast<qlonglong>( m_limitOffset ) );
+        queryString += QLatin1String( " LIMIT " ) + registerBindValue( static_cast<qlonglong>( m_limitLength ) );
+    }
+    if ( m_pageLength >= 0 ) {
+        queryString += QLatin1String( " LIMIT " ) + registerBindValue( static_cast<qlonglong>( m_pageLength ) );
     }
 
     return queryString;
 }
 
+QString SqlSelectQueryBuilder::keysetCondition( const QVector<QPair<QString, Qt::SortOrder> > &sortColumns )
+{
+    Q_ASSERT( m_pageValues.size() == sortColumns.size() );
+    QStringList columns;
+    QStringList placeholders;
+    bool uniformOrder = true;
+    for ( int i = 0; i < sortColumns.size(); ++i ) {
+        Q_ASSERT( m_pageValues.at( i ).isValid() );
+        columns.push_back( sortColumns.at( i ).first );
+        placeholders.push_back( registerBindValue( m_pageValues.at( i ) ) );
+        uniformOrder = uniformOrder && sortColumns.at( i ).second == sortColumns.first().second;
+    }
+
+    // a row value comparison can use a multi-column index directly
+    if ( uniformOrder ) {
+        const QLatin1String op = sortColumns.first().second == Qt::AscendingOrder ? QLatin1String( " > " ) : QLatin1String( " < " );
+        if ( columns.size() == 1 )
+            return columns.first() + op + placeholders.first();
+        return QLatin1Char( '(' ) + columns.join( QLatin1String( ", " ) ) + QLatin1Char( ')' ) + op
+             + QLatin1Char( '(' ) + placeholders.join( QLatin1String( ", " ) ) + QLatin1Char( ')' );
+    }
+
+    // mixed orders: (c1 > :0) OR (c1 = :0 AND c2 < :1) OR ...
+    QStringList terms;
+    for ( int i = 0; i < columns.size(); ++i ) {
+        QString term = QLatin1String( "(" );
+        for ( int j = 0; j < i; ++j )
+            term += columns.at( j ) + QLatin1String( " = " ) + placeholders.at( j ) + QLatin1String( " AND " );
+        term += columns.at( i );
+        term += sortColumns.at( i ).second == Qt::AscendingOrder ? QLatin1String( " > " ) : QLatin1String( " < " );
+        term += placeholders.at( i ) + QLatin1Char( ')' );
+        terms.push_back( term );
+    }
+    return QLatin1Char( '(' ) + terms.join( QLatin1String( " OR " ) ) + QLatin1Char( ')' );
+}
+
+QString SqlSelectQueryBuilder::withClause()
+{
+    if ( m_commonTableExpressions.isEmpty() )
+        return QString();
+    bool recursive = false;
+    QStringList expressions;
+    foreach ( const CommonTableExpression &cte, m_commonTableExpressions ) {
+        QString expression = cte.name;
+        if ( !cte.columns.isEmpty() )
+            expression += QLatin1Char( '(' ) + cte.columns.join( QLatin1String( ", " ) ) + QLatin1Char( ')' );
+        expression += QLatin1String( " AS (" ) + subQueryToString( *cte.query );
+        if ( cte.recursiveQuery ) {
+            recursive = true;
+            expression += QLatin1String( " UNION ALL " ) + subQueryToString( *cte.recursiveQuery );
+        }
+        expression += QLatin1Char( ')' );
+        expressions.push_back( expression );
+    }
+    // RECURSIVE applies to the entire WITH clause
+    return QLatin1String( recursive ? "WITH RECURSIVE " : "WITH " ) + expressions.join( QLatin1String( ", " ) ) + QLatin1Char( ' ' );
+}
+
 QVector<QVariant> SqlSelectQueryBuilder::bindValuesList()
 {
     return m_bindValues;
@@ -213,7 +427,10 @@ void SqlSelectQueryBuilder::combineQueries(SqlSelectQueryBuilder &query1, SqlSel
         m_queryString = query1String + unionName +  query2.toString();
         m_assembled = true;
         m_bindValues = query1.bindValuesList() + query2.bindValuesList();
-        prepareQuery();
+#ifndef QUERYBUILDER_UNITTEST
+        m_query = prepareQuery( m_queryString );
+        bindQueryValues();
+#endif
     }
     else {
         SQLDEBUG << "WARNING: you tried to combine queries in a non-empty SqlSelectQueryBuilder, the queries weren't combined. (SqlSelectQueryBuilder stays inchanged).";
@@ -222,7 +439,16 @@ void SqlSelectQueryBuilder::combineQueries(SqlSelectQueryBuilder &query1, SqlSel
 
 void SqlSelectQueryBuilder::addLimit(uint offset, uint length)
 {
+    Q_ASSERT( m_pageLength < 0 );
     m_limitOffset = offset;
     m_limitLength = length;
 }
 
+void SqlSelectQueryBuilder::setPageAfter(const QVector<QVariant>& lastValues, uint length)
+{
+    Q_ASSERT( m_limitOffset == static_cast<uint>( -1 ) );
+    Q_ASSERT( lastValues.isEmpty() || lastValues.size() == m_sortColumns.size() );
+    m_pageValues = lastValues;
+    m_pageLength = length;
+}
+
@@ -26,6 +26,7 @@
 #include "SqlCondition.h"
 #include "sqlate_export.h"
 
+#include <QSharedPointer>
 #include <QStringList>
 
 #include <boost/mpl/assert.hpp>
@@ -57,6 +58,14 @@ public:
         UnionAll
     };
 
+    /// A common table expression, see addCommonTableExpression()
+    struct CommonTableExpression {
+        QString name;
+        QStringList columns;
+        QSharedPointer<const SqlSelectQueryBuilder> query;
+        QSharedPointer<const SqlSelectQueryBuilder> recursiveQuery; ///< null for non-recursive expressions
+    };
+
     /// Create a new query builder for the given database
     explicit SqlSelectQueryBuilder( const QSqlDatabase &db = QSqlDatabase::database() );
 
@@ -65,6 +74,7 @@ public:
 
     /// Use SELECT DISTINCT ON(...), PostgreSQL-only
     /// mutually exclusive with setDistinct()
+    /// @note @p distinctExpr is part of the statement text, it can't contain bound values
     void setDistinctOn( const QString &distinctExpr ) { m_distinctOn = distinctExpr; }
 
     /// Get the current distinct query status
@@ -128,6 +138,24 @@ public:
         addJoin( joinType, table, c );
     }
 
+    /**
+     * WITH @p name (@p columns) AS (@p query) ...
+     * The result of @p query can be used like a table called @p name in this query, e.g. with setTable() or addJoin().
+     * @param columns the column names of the result, if they should differ from the ones of @p query
+     */
+    void addCommonTableExpression( const QString &name, const SqlSelectQueryBuilder &query, const QStringList &columns = QStringList() );
+
+    /**
+     * WITH RECURSIVE @p name (@p columns) AS (@p initialQuery UNION ALL @p recursiveQuery) ...
+     * @p recursiveQuery refers to @p name to compute further rows from the ones found so far, until it returns no more rows.
+     * This allows walking a hierarchy in one query, see Sql::ancestors().
+     */
+    void addRecursiveCommonTableExpression( const QString &name, const QStringList &columns,
+                                            const SqlSelectQueryBuilder &initialQuery, const SqlSelectQueryBuilder &recursiveQuery );
+
+    /// Adds a common table expression as created by the above methods.
+    void addCommonTableExpression( const CommonTableExpression &expression );
+
     /// ... ORDER BY @p column @p sortOrder ...
     void addSortColumn( const QString& column, Qt::SortOrder sortOrder = Qt::AscendingOrder );
     template <typename Column>
@@ -152,17 +180,43 @@ public:
         addGroupColumn( column.name() );
     }
 
-    /// Returns the created query object, when called first, the query object is assembled and prepared
-    /*reimp*/ SqlQuery& query();
+    /// access to the HAVING condition, applied to the groups created by addGroupColumn()
+    SqlCondition& havingCondition();
+
+    /**
+     * Access to the QUALIFY condition, which filters rows on the results of window functions,
+     * e.g. "ROW_NUMBER() OVER (PARTITION BY ... ORDER BY ...) <= 3" for the top 3 rows per group.
+     * PostgreSQL doesn't allow window functions in WHERE, so the query is wrapped into a derived table,
+     * with this condition, ORDER BY and the limits applied outside of it. Columns used there don't need to be selected.
+     * Can't be combined with row locks. Combining it with addAllColumns() or setDistinctOn() throws an SqlException
+     * when the statement is assembled, as these can't refer to the aliased columns of the derived table.
+     */
+    SqlCondition& qualifyCondition();
 
     /**
      * @brief Limit the query results
      *
+     * Offset and length are bound as values, so all pages share one prepared statement.
+     *
      * @param offset starting offset
      * @param length max numbers of returned items
      **/
     void addLimit(uint offset, uint length);
 
+    /**
+     * @brief Keyset pagination, an alternative to addLimit() that doesn't get slower for later pages
+     *
+     * Returns the first @p length rows sorting after the row whose sort columns have the values @p lastValues,
+     * ie. the page following the one ending with that row. Pass an empty @p lastValues for the first page.
+     * The sort columns need to be added with addSortColumn() and must form a unique key (e.g. end with the primary key),
+     * mixed sort orders are supported. Sort columns can't contain NULL values.
+     * Can't be combined with addLimit().
+     *
+     * @param lastValues one value per sort column, in the order of addSortColumn()
+     * @param length max numbers of returned items
+     **/
+    void setPageAfter(const QVector<QVariant> &lastValues, uint length);
+
 public:
     /**
      * Select and add a exclusive row lock on the result set.
@@ -201,19 +255,28 @@ public:
 private:
     friend class SelectQueryBuilderTest;
     friend class SelectTest;
+    friend class SqlCursor;
+    friend class SqlCondition;
+    friend class SqlConditionalQueryBuilderBase;
 
     /**
      * return the query as a formatted string
      */
     QString toString();
 
-    /**
-     * return the builder as a SqlQuery. The method throws an SqlException on error.
-     */
-    void prepareQuery();
+    /*reimp*/ void assembleQuery();
+    /*reimp*/ Fingerprint fingerprint() const;
+    /*reimp*/ void collectBindValues();
 
     QVector<QVariant> bindValuesList();
 
+    /** Returns the WITH clause for m_commonTableExpressions, registering the values to bind. */
+    QString withClause();
+
+    /** Returns the condition selecting the rows after m_pageValues in @p sortColumns order, registering the values to bind. */
+    QString keysetCondition( const QVector<QPair<QString, Qt::SortOrder> > &sortColumns );
+
+    QVector<CommonTableExpression> m_commonTableExpressions;
     QVector<QPair<QString, QString> > m_columns;
     struct JoinInfo {
         JoinType type;
@@ -223,12 +286,16 @@ private:
     QVector<JoinInfo> m_joins;
     QVector<QPair<QString, Qt::SortOrder> > m_sortColumns;
     QStringList m_groupColumns;
+    SqlCondition m_havingCondition;
+    SqlCondition m_qualifyCondition;
     QStringList m_lockTablesForUpdate;
     QString m_distinctOn;
     bool m_lockNoWait;
     bool m_distinct;
     uint m_limitOffset;
     uint m_limitLength;
+    QVector<QVariant> m_pageValues;
+    int m_pageLength;
 };
 
 #endif
@@ -23,20 +23,22 @@
 #include "SqlExceptions.h"
 #include "SqlQueryManager.h"
 
+#include <QMutex>
 #include <QSqlDriver>
 
 QHash<QString, int> SqlTransaction::m_refCounts;
+Q_GLOBAL_STATIC( QMutex, s_refCountsMutex )
 
 SqlTransaction::SqlTransaction(const QSqlDatabase& db) : m_db( db ), m_disarmed( false )
 {
     SqlQueryManager::instance()->checkDbIsAlive(m_db);
     Q_ASSERT( db.driver()->hasFeature( QSqlDriver::Transactions ) );
-    if ( m_refCounts.value( m_db.connectionName() ) == 0 && !m_db.transaction() ) {
+    if ( refCount( m_db.connectionName() ) == 0 && !m_db.transaction() ) {
         SqlQueryManager::instance()->checkDbIsAlive(m_db); //double check is needed, as Qt might not set m_db.isOpen() to false after connection loss if no queries were run meantime.
-        if ( m_refCounts.value( m_db.connectionName() ) == 0 && !m_db.transaction() )
+        if ( refCount( m_db.connectionName() ) == 0 && !m_db.transaction() )
             throw SqlException( m_db.lastError() );
     }
-    m_refCounts[m_db.connectionName()]++;
+    addRef( m_db.connectionName(), 1 );
 }
 
 SqlTransaction::~SqlTransaction()
@@ -44,38 +46,58 @@ SqlTransaction::~SqlTransaction()
     if ( m_disarmed )
         return;
     SqlQueryManager::instance()->checkDbIsAlive(m_db);
-    if ( m_refCounts.value( m_db.connectionName() ) == 1 )
+    if ( refCount( m_db.connectionName() ) == 1 )
         m_db.rollback();
-    m_refCounts[m_db.connectionName()]--;
+    addRef( m_db.connectionName(), -1 );
 }
 
 void SqlTransaction::commit()
 {
     SqlQueryManager::instance()->checkDbIsAlive(m_db);
-    Q_ASSERT( m_refCounts.value( m_db.connectionName() ) > 0 );
-    if ( m_refCounts.value( m_db.connectionName() ) == 1 && !m_db.commit() ) {
+    Q_ASSERT( refCount( m_db.connectionName() ) > 0 );
+    if ( refCount( m_db.connectionName() ) == 1 && !m_db.commit() ) {
         SqlQueryManager::instance()->checkDbIsAlive(m_db);  //double check is needed, as Qt might not set m_db.isOpen() to false after connection loss if no queries were run meantime.
-        if ( m_refCounts.value( m_db.connectionName() ) == 1 && !m_db.commit() )
+        if ( refCount( m_db.connectionName() ) == 1 && !m_db.commit() )
             throw SqlException( m_db.lastError() );
     }
-    m_refCounts[ m_db.connectionName() ]--;
+    addRef( m_db.connectionName(), -1 );
     m_disarmed = true;
 }
 
 void SqlTransaction::rollback()
 {
     SqlQueryManager::instance()->checkDbIsAlive(m_db);
-    Q_ASSERT( m_refCounts.value( m_db.connectionName() ) > 0 );
-    m_refCounts[ m_db.connectionName() ]--;
+    Q_ASSERT( refCount( m_db.connectionName() ) > 0 );
+    addRef( m_db.connectionName(), -1 );
     m_disarmed = true;
-    if ( m_refCounts.value( m_db.connectionName() ) == 0 && !m_db.rollback() ) {
+    if ( refCount( m_db.connectionName() ) == 0 && !m_db.rollback() ) {
         SqlQueryManager::instance()->checkDbIsAlive(m_db);  //double check is needed, as Qt might not set m_db.isOpen() to false after connection loss if no queries were run meantime.
-        if ( m_refCounts.value( m_db.connectionName() ) == 0 && !m_db.rollback() )
+        if ( refCount( m_db.connectionName() ) == 0 && !m_db.rollback() )
             throw SqlException( m_db.lastError() );
     }
 }
 
 int SqlTransaction::transactionsCount()
 {
+    QMutexLocker locker( s_refCountsMutex() );
     return m_refCounts.size();
 }
+
+bool SqlTransaction::isActive(const QSqlDatabase& db)
+{
+    return refCount( db.connectionName() ) > 0;
+}
+
+int SqlTransaction::refCount(const QString& connectionName)
+{
+    QMutexLocker locker( s_refCountsMutex() );
+    return m_refCounts.value( connectionName );
+}
+
+int SqlTransaction::addRef(const QString& connectionName, int delta)
+{
+    QMutexLocker locker( s_refCountsMutex() );
+    int &count = m_refCounts[connectionName];
+    count += delta;
+    return count;
+}
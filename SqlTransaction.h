@@ -28,7 +28,8 @@
 
 /**
  * Simple RAII class for transaction handling.
- * @note this is not (yet) thread-safe!
+ * Nested transactions on the same connection are reference counted, only the outermost one talks to the database.
+ * @note Connections can be used from different threads, but a transaction object has to stay in the thread of its connection.
  */
 class SQLATE_EXPORT SqlTransaction
 {
@@ -65,10 +66,17 @@ public:
 
     static int transactionsCount();
 
+    /** Returns @c true if a SqlTransaction is open on @p db. */
+    static bool isActive( const QSqlDatabase &db );
+
 private:
     Q_DISABLE_COPY( SqlTransaction )
+    static int refCount( const QString &connectionName );
+    /// adds @p delta to the reference count of @p connectionName and returns the new count
+    static int addRef( const QString &connectionName, int delta );
+
     QSqlDatabase m_db;
-    static QHash<QString, int> m_refCounts;
+    static QHash<QString, int> m_refCounts; // guarded by a mutex, see addRef()
     bool m_disarmed;
 };
 
@@ -40,49 +40,60 @@ void SqlUpdateQueryBuilder::setIncludesubTales(bool includeSubTables)
     m_includeSubTables = includeSubTables;
 }
 
-SqlQuery& SqlUpdateQueryBuilder::query()
+void SqlUpdateQueryBuilder::assembleQuery()
 {
-    if ( !m_assembled ) {
-        QStringList cols;
-        m_queryString = QLatin1String( "UPDATE " );
-        if (!m_includeSubTables) {
-            m_queryString += QLatin1String( "ONLY " );
-        }
-        m_queryString += m_table;
+    m_queryString = QLatin1String( "UPDATE " );
+    if (!m_includeSubTables) {
+        m_queryString += QLatin1String( "ONLY " );
+    }
+    m_queryString += m_table;
 
-        m_queryString += QLatin1String( " SET " );
-        m_bindValues.clear();
-        typedef QPair<QString, QVariant> ColumnValuePair;
-        foreach ( const ColumnValuePair &col, m_columns ) {
-            m_queryString += col.first;
-            m_queryString += QLatin1String( " = " );
-            if ( col.second.userType() == qMetaTypeId<SqlNowType>() )
-                m_queryString += currentDateTime();
-            else
-                m_queryString += registerBindValue( col.second );
-            m_queryString += QLatin1String(", ");
-        }
-        if ( m_queryString.endsWith( QLatin1String(", ") ) )
-            m_queryString.remove( m_queryString.length() - 2, 2);
+    m_queryString += QLatin1String( " SET " );
+    m_bindValues.clear();
+    typedef QPair<QString, QVariant> ColumnValuePair;
+    foreach ( const ColumnValuePair &col, m_columns ) {
+        m_queryString += col.first;
+        m_queryString += QLatin1String( " = " );
+        if ( col.second.userType() == qMetaTypeId<SqlNowType>() )
+            m_queryString += currentDateTime();
+        else
+            m_queryString += registerBindValue( col.second );
+        m_queryString += QLatin1String(", ");
+    }
+    if ( m_queryString.endsWith( QLatin1String(", ") ) )
+        m_queryString.remove( m_queryString.length() - 2, 2);
 
-        if ( m_whereCondition.hasSubConditions() ) {
-            m_queryString += QLatin1String( " WHERE " );
-            m_queryString += conditionToString( m_whereCondition );
-        }
+    if ( m_whereCondition.hasSubConditions() ) {
+        m_queryString += QLatin1String( " WHERE " );
+        m_queryString += conditionToString( m_whereCondition );
+    }
+    m_queryString += returningClause();
 
-        m_queryString = m_queryString.trimmed();
-        m_assembled = true;
+    m_queryString = m_queryString.trimmed();
+}
 
-#ifndef QUERYBUILDER_UNITTEST
-        m_query = prepareQuery( m_queryString );
+SqlQueryBuilderBase::Fingerprint SqlUpdateQueryBuilder::fingerprint() const
+{
+    Fingerprint fp;
+    fp << QLatin1String( "UPDATE" ) << m_bindedValuesOffset << m_includeSubTables << m_table << m_columns.size();
+    typedef QPair<QString, QVariant> ColumnValuePair;
+    foreach ( const ColumnValuePair &col, m_columns )
+        fp << col.first << col.second;
+    hashCondition( fp, m_whereCondition );
+    fp << m_returningColumns.join( QLatin1String( "," ) );
+    return fp;
+}
 
-        for ( int i = 0; i < m_bindValues.size(); ++i ) {
-            const QVariant value = m_bindValues.at( i );
-            bindValue( i, value );
-        }
-#endif
+void SqlUpdateQueryBuilder::collectBindValues()
+{
+    // same order as assembleQuery() registers them
+    m_bindValues.clear();
+    typedef QPair<QString, QVariant> ColumnValuePair;
+    foreach ( const ColumnValuePair &col, m_columns ) {
+        if ( col.second.userType() != qMetaTypeId<SqlNowType>() )
+            m_bindValues.push_back( col.second );
     }
-    return m_query;
+    m_whereCondition.collectBindValues( m_bindValues, valueListBinding() );
 }
 
 QStringList SqlUpdateQueryBuilder::columnNames() const
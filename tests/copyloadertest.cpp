@@ -0,0 +1,135 @@
+#include "testschema.h"
+#include "testbase.h"
+#include "Sql.h"
+#include "SqlCopyLoader.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace Sql;
+
+class CopyLoaderTest : public TestBase
+{
+    Q_OBJECT
+private:
+    int countPrefixes( const QString &description )
+    {
+        QSqlQuery query;
+        query.prepare( QLatin1String( "SELECT count(*) FROM lutPrefix WHERE description = ?" ) );
+        query.addBindValue( description );
+        if ( !query.exec() || !query.next() )
+            return -1;
+        return query.value( 0 ).toInt();
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        openDbTest();
+        createEmptyDb();
+    }
+
+    void testLoad_data()
+    {
+        QTest::addColumn<int>( "format" );
+        QTest::newRow( "text" ) << int( SqlCopyLoader::TextFormat );
+        QTest::newRow( "binary" ) << int( SqlCopyLoader::BinaryFormat );
+    }
+
+    void testLoad()
+    {
+        QFETCH( int, format );
+        const QString description = QString::fromLatin1( "load %1" ).arg( format );
+        const int rows = 10000;
+
+        CopyLoader<PrefixType> loader;
+        loader.setFormat( static_cast<SqlCopyLoader::Format>( format ) );
+        loader.setBufferSize( 4096 ); // force multiple flushes
+        for ( int i = 0; i < rows; ++i )
+            loader.addRow( std::make_tuple( QUuid::createUuid(), QString::number( i ), description ) );
+        QCOMPARE( loader.finish(), qint64( rows ) );
+        QVERIFY( loader.rowsPerSecond() >= 0.0 );
+
+        QCOMPARE( countPrefixes( description ), rows );
+    }
+
+    void testEscaping_data()
+    {
+        testLoad_data();
+    }
+
+    void testEscaping()
+    {
+        QFETCH( int, format );
+        const QString description = QString::fromLatin1( "tab\there\nnewline \\N backslash %1" ).arg( format );
+
+        CopyLoader<PrefixType, boost::mpl::vector<PrefixType::idType, PrefixType::shortDescriptionType, PrefixType::descriptionType> > loader;
+        loader.setFormat( static_cast<SqlCopyLoader::Format>( format ) );
+        loader.addRow( std::make_tuple( QUuid::createUuid(), SqlNull, description ) );
+        loader.finish();
+
+        QCOMPARE( countPrefixes( description ), 1 );
+    }
+
+    void testColumnValues()
+    {
+        const QString description = QString::fromLatin1( "column values" );
+        CopyLoader<PrefixType> loader;
+        loader.addRow( Prefix.description << description & Prefix.id << QUuid::createUuid() );
+        loader.addRow( Prefix.id << QUuid::createUuid() & Prefix.description << description & Prefix.shortDescription << QString::fromLatin1( "x" ) );
+        loader.finish();
+
+        QCOMPARE( countPrefixes( description ), 2 );
+    }
+
+    void testRejectedRow_data()
+    {
+        testLoad_data();
+    }
+
+    void testRejectedRow()
+    {
+        if ( !SqlCopyLoader::isCopySupported() )
+            QSKIP( "SqlNow is only rejected by COPY" );
+        QFETCH( int, format );
+        const QString description = QString::fromLatin1( "rejected row %1" ).arg( format );
+
+        SqlCopyLoader loader;
+        loader.setTable( Prefix );
+        loader.addColumn( Prefix.id );
+        loader.addColumn( Prefix.description );
+        loader.addColumn( Prefix.shortDescription );
+        loader.setFormat( static_cast<SqlCopyLoader::Format>( format ) );
+        loader.addRow( QVector<QVariant>() << QVariant::fromValue( QUuid::createUuid() ) << QVariant( description ) << QVariant( QString::fromLatin1( "a" ) ) );
+        // the rejected row must not leave a partial row behind
+        bool thrown = false;
+        try {
+            loader.addRow( QVector<QVariant>() << QVariant::fromValue( QUuid::createUuid() ) << QVariant( description ) << QVariant::fromValue( SqlNow ) );
+        } catch ( const SqlException & ) {
+            thrown = true;
+        }
+        QVERIFY( thrown );
+        loader.addRow( QVector<QVariant>() << QVariant::fromValue( QUuid::createUuid() ) << QVariant( description ) << QVariant( QString::fromLatin1( "b" ) ) );
+        QCOMPARE( loader.finish(), qint64( 2 ) );
+        QVERIFY( loader.elapsed() >= 0 );
+
+        QCOMPARE( countPrefixes( description ), 2 );
+    }
+
+    void testAbort()
+    {
+        const QString description = QString::fromLatin1( "aborted" );
+        {
+            CopyLoader<PrefixType> loader;
+            loader.addRow( std::make_tuple( QUuid::createUuid(), QString(), description ) );
+        }
+        QCOMPARE( countPrefixes( description ), 0 );
+
+        // the connection is usable afterwards
+        QCOMPARE( countPrefixes( QString::fromLatin1( "column values" ) ), 2 );
+    }
+};
+
+QTEST_MAIN( CopyLoaderTest )
+
+#include "copyloadertest.moc"
@@ -63,6 +63,25 @@ private Q_SLOTS:
         QCOMPARE( Sql::createTableStatement( Sql::PersonBossRelation ), s );
     }
 
+    void testClosureTable()
+    {
+        QString s = QString::fromLatin1( "CREATE TABLE rltDirectoratesHierarchy_closure (\n"
+                                            "descendant UUID NOT NULL REFERENCES lutDirectorates (id) ON DELETE CASCADE,\n"
+                                            "ancestor UUID NOT NULL REFERENCES lutDirectorates (id) ON DELETE CASCADE,\n"
+                                            "paths INTEGER NOT NULL,\n"
+                                            "UNIQUE( descendant, ancestor ),\n"
+                                            "UNIQUE( ancestor, descendant )\n)" );
+        QCOMPARE( Sql::createTableStatement<Sql::ClosureTable<Sql::DirectoratesHierarchyType> >(), s );
+        QVERIFY( Sql::tableNames<Sql::SQLateTestSchema>().contains( QLatin1String( "rltDirectoratesHierarchy_closure" ) ) );
+
+        const QStringList triggers = Sql::createTableTriggerStatements( Sql::DirectoratesHierarchy );
+        QCOMPARE( triggers.size(), 4 );
+        QCOMPARE( triggers.at( 2 ), QString::fromLatin1( "CREATE TRIGGER rltDirectoratesHierarchy_closure_maintain "
+                                                         "AFTER INSERT OR DELETE OR UPDATE OF fk_lutDirectorates_id, fk_lutDirectorates_id_link on rltDirectoratesHierarchy "
+                                                         "FOR EACH ROW EXECUTE PROCEDURE rltDirectoratesHierarchy_closure_maintain()" ) );
+        QVERIFY( Sql::createTableTriggerStatements( Sql::PersonBossRelation ).isEmpty() );
+    }
+
     void testDefault()
     {
         QString s = QString::fromLatin1( "CREATE TABLE lutPersonRoles (\n"
@@ -0,0 +1,78 @@
+#include "testschema.h"
+#include "testbase.h"
+#include "Sql.h"
+#include "SqlCursor.h"
+#include "SqlSelect.h"
+#include "SqlTransaction.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace Sql;
+
+class CursorTest : public TestBase
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        openDbTest();
+        createEmptyDb();
+        QSqlQuery query;
+        QVERIFY( query.exec( QLatin1String( "INSERT INTO lutPrefix (id, short_desc, description) "
+                                            "SELECT md5(i::text)::uuid, i::text, 'cursor' FROM generate_series(1, 2500) AS i" ) ) );
+    }
+
+    void testStream_data()
+    {
+        QTest::addColumn<int>( "batchSize" );
+        QTest::newRow( "multiple batches" ) << 100;
+        QTest::newRow( "exact multiple" ) << 500;
+        QTest::newRow( "single batch" ) << 5000;
+    }
+
+    void testStream()
+    {
+        QFETCH( int, batchSize );
+        SqlCursor cursor( select( Prefix.shortDescription ).from( Prefix )
+                          .where( Prefix.description == QString::fromLatin1( "cursor" ) ), batchSize );
+        int sum = 0;
+        while ( cursor.next() )
+            sum += cursor.value( 0 ).toInt();
+        QCOMPARE( cursor.rowCount(), qint64( 2500 ) );
+        QCOMPARE( sum, 2500 * 2501 / 2 );
+        QVERIFY( !cursor.next() );
+        cursor.close();
+    }
+
+    void testBuilder()
+    {
+        SqlSelectQueryBuilder qb;
+        qb.setTable( Prefix );
+        qb.addColumn( Prefix.shortDescription );
+        qb.whereCondition().addValueCondition( Prefix.shortDescription, SqlCondition::Equals, QString::fromLatin1( "42" ) );
+        SqlCursor cursor( qb, 10 );
+        QVERIFY( cursor.next() );
+        QCOMPARE( cursor.value( 0 ).toString(), QString::fromLatin1( "42" ) );
+        QVERIFY( !cursor.next() );
+    }
+
+    void testDestroyInTransaction()
+    {
+        SqlTransaction t;
+        {
+            SqlCursor cursor( select( Prefix.shortDescription ).from( Prefix ), 10 );
+            QVERIFY( cursor.next() );
+        }
+        // the outer transaction is still running, the cursor must be gone nevertheless
+        QSqlQuery query;
+        QVERIFY( query.exec( QLatin1String( "SELECT count(*) FROM pg_cursors WHERE name LIKE 'sqlate_cursor_%'" ) ) );
+        QVERIFY( query.next() );
+        QCOMPARE( query.value( 0 ).toInt(), 0 );
+        t.commit();
+    }
+};
+
+QTEST_MAIN( CursorTest )
+
+#include "cursortest.moc"
@@ -57,6 +57,33 @@ private Q_SLOTS:
         QCOMPARE( qb.m_queryString, sql );
         QCOMPARE( qb.m_bindValues, values);
     }
+
+    void testExecBatch()
+    {
+        QSqlQuery query;
+        QVERIFY( query.exec( QLatin1String( "CREATE TABLE batchdelete1 (first VARCHAR(128), second INTEGER)" ) ) );
+        for ( int i = 0; i < 4; ++i )
+            QVERIFY( query.exec( QString::fromLatin1( "INSERT INTO batchdelete1 (first, second) VALUES ('batch', %1)" ).arg( i ) ) );
+
+        // a dummy value, to get its placeholder
+        SqlDeleteQueryBuilder qb;
+        qb.setTable( QLatin1String( "batchdelete1" ) );
+        qb.whereCondition().addValueCondition( QLatin1String( "second" ), SqlCondition::Equals, -1 );
+        qb.whereCondition().addPlaceholderCondition( QLatin1String( "first" ), SqlCondition::Equals, QLatin1String( ":first" ) );
+
+        QVector<QVariantList> values;
+        values << ( QVariantList() << 0 << 2 << 5 );
+        QHash<QString, QVariantList> namedValues;
+        namedValues.insert( QLatin1String( ":first" ), QVariantList() << QLatin1String( "batch" ) << QLatin1String( "batch" ) << QLatin1String( "batch" ) );
+        qb.execBatch( values, namedValues );
+
+        QVERIFY( query.exec( QLatin1String( "SELECT second FROM batchdelete1 ORDER BY second" ) ) );
+        QVERIFY( query.next() );
+        QCOMPARE( query.value( 0 ).toInt(), 1 );
+        QVERIFY( query.next() );
+        QCOMPARE( query.value( 0 ).toInt(), 3 );
+        QVERIFY( !query.next() );
+    }
 };
 
 QTEST_MAIN( DeleteQueryBuilderTest )
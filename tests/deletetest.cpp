@@ -58,6 +58,24 @@ private Q_SLOTS:
         QCOMPARE( qb.m_queryString, sql );
         QCOMPARE( qb.m_bindValues, bindVals );
     }
+
+    void testStaticStatement()
+    {
+        const detail::StaticStatement *stmt1 = del().from( Person ).where( Person.PersonSurname == QString::fromLatin1( "Ford" ) ).staticStatement();
+        QVERIFY( stmt1 );
+        QCOMPARE( stmt1->text, QString::fromLatin1( "DELETE FROM tblPerson WHERE tblPerson.PersonSurname = :0" ) );
+        QCOMPARE( del().from( Person ).where( Person.PersonSurname == QString::fromLatin1( "Carter" ) ).staticStatement(), stmt1 );
+        QVERIFY( !del().from( Person ).where( Person.PersonSurname == placeholder( ":name" ) ).staticStatement() );
+    }
+
+    void testReturning()
+    {
+        DeleteExpr<PersonType, detail::missing> expr = del().from( Person ).returning( Person.id, Person.PersonSurname );
+        QVERIFY( !expr.staticStatement() );
+        QCOMPARE( expr.queryBuilder().statement(), QString::fromLatin1( "DELETE FROM tblPerson RETURNING id, PersonSurname" ) );
+        QCOMPARE( del().from( Person ).where( Person.PersonSurname == QString::fromLatin1( "Ford" ) ).returning( Person.id ).queryBuilder().statement(),
+                  QString::fromLatin1( "DELETE FROM tblPerson WHERE tblPerson.PersonSurname = :0 RETURNING id" ) );
+    }
 };
 
 QTEST_MAIN( DeleteTest )
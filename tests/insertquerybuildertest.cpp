@@ -5,6 +5,7 @@
 #include "testschema.h"
 
 #include "Sql.h"
+#include "SqlExceptions.h"
 #include "SqlInsertQueryBuilder.h"
 
 #include <QObject>
@@ -94,6 +95,17 @@ private Q_SLOTS:
         columns << QL1S("id") << QL1S("ts") << QL1S("txt");
         values << QVariant::fromValue( hoId ) << QVariant::fromValue<SqlNowType>(SqlNow) << QVariant();
         QTest::newRow("server-side now") << qb << "INSERT INTO tblReport (id,ts,txt) VALUES (:0,now(),:2)" << columns << values;
+
+        qb = SqlInsertQueryBuilder();
+        qb.setTable( QL1S("table1") );
+        qb.addColumn( QL1S("first") );
+        qb.addColumn( QL1S("second") );
+        qb.addRow( QVector<QVariant>() << QL1S("1") << 1 );
+        qb.addRow( QVector<QVariant>() << QL1S("2") << QVariant() );
+        columns.clear();
+        values.clear();
+        columns << QL1S("first") << QL1S("second");
+        QTest::newRow( "2 rows" ) << qb << "INSERT INTO table1 (first,second) VALUES (:0,:1),(:2,:3)" << columns << values;
     }
 
     void testQueryBuilder()
@@ -110,6 +122,155 @@ private Q_SLOTS:
         QCOMPARE( qb.m_values.size(), values.size() );
         QVERIFY( std::equal( qb.m_values.begin(), qb.m_values.end(), values.begin(), deepVariantCompare ) );
     }
+
+    void testBindOrder()
+    {
+        // columns not in alphabetical order
+        SqlInsertQueryBuilder qb;
+        qb.setTable( QL1S("table1") );
+        qb.addColumnValue( QL1S("second"), 23 );
+        qb.addColumnValue( QL1S("first"), QL1S("bind order") );
+        qb.exec();
+
+        QSqlQuery query;
+        QVERIFY( query.exec( QLatin1String( "SELECT second FROM table1 WHERE first = 'bind order'" ) ) );
+        QVERIFY( query.next() );
+        QCOMPARE( query.value( 0 ).toInt(), 23 );
+    }
+
+    void testMultiRowExec()
+    {
+        SqlInsertQueryBuilder qb;
+        qb.setTable( QL1S("table1") );
+        qb.addColumn( QL1S("first") );
+        qb.addColumn( QL1S("second") );
+        // more than one full chunk, plus a remainder that is not a power of two
+        const int rows = qb.maxRowsPerStatement() + 123;
+        for ( int i = 0; i < rows; ++i )
+            qb.addRow( QVector<QVariant>() << QL1S("multi-row") << i );
+        QCOMPARE( qb.rowCount(), rows );
+
+        // too many rows for a single statement
+        bool thrown = false;
+        try {
+            qb.statement();
+        } catch ( const SqlException & ) {
+            thrown = true;
+        }
+        QVERIFY( thrown );
+
+        qb.exec();
+
+        QSqlQuery query;
+        QVERIFY( query.exec( QLatin1String( "SELECT count(*), count(DISTINCT second), max(second) FROM table1 WHERE first = 'multi-row'" ) ) );
+        QVERIFY( query.next() );
+        QCOMPARE( query.value( 0 ).toInt(), rows );
+        QCOMPARE( query.value( 1 ).toInt(), rows );
+        QCOMPARE( query.value( 2 ).toInt(), rows - 1 );
+    }
+
+    void testExecBatch()
+    {
+        // dummy values, to get a placeholder for each
+        SqlInsertQueryBuilder qb;
+        qb.setTable( QL1S("table1") );
+        qb.addColumnValue( QL1S("first"), QL1S("dummy") );
+        qb.addColumnValue( QL1S("second"), 0 );
+
+        QVector<QVariantList> values;
+        values << ( QVariantList() << QL1S("insert batch") << QL1S("insert batch") << QL1S("insert batch") );
+        values << ( QVariantList() << 0 << 1 << 2 );
+        qb.execBatch( values );
+
+        QSqlQuery query;
+        QVERIFY( query.exec( QLatin1String( "SELECT second FROM table1 WHERE first = 'insert batch' ORDER BY second" ) ) );
+        for ( int i = 0; i < 3; ++i ) {
+            QVERIFY( query.next() );
+            QCOMPARE( query.value( 0 ).toInt(), i );
+        }
+        QVERIFY( !query.next() );
+        QVERIFY( query.exec( QLatin1String( "SELECT count(*) FROM table1 WHERE first = 'dummy'" ) ) );
+        QVERIFY( query.next() );
+        QCOMPARE( query.value( 0 ).toInt(), 0 );
+    }
+
+    void testExecBatchMismatch()
+    {
+        SqlInsertQueryBuilder qb;
+        qb.setTable( QL1S("table1") );
+        qb.addColumnValue( QL1S("first"), QL1S("dummy") );
+        qb.addColumnValue( QL1S("second"), 0 );
+
+        // too few value lists
+        bool thrown = false;
+        try {
+            qb.execBatch( QVector<QVariantList>() << ( QVariantList() << QL1S("mismatch") ) );
+        } catch ( const SqlException & ) {
+            thrown = true;
+        }
+        QVERIFY( thrown );
+
+        // lists of different lengths
+        thrown = false;
+        try {
+            qb.execBatch( QVector<QVariantList>() << ( QVariantList() << QL1S("mismatch") << QL1S("mismatch") ) << ( QVariantList() << 0 ) );
+        } catch ( const SqlException & ) {
+            thrown = true;
+        }
+        QVERIFY( thrown );
+    }
+
+    void testOnConflict()
+    {
+        QSqlQuery query;
+        QVERIFY( query.exec( QLatin1String( "CREATE TABLE upsert1 (key INTEGER PRIMARY KEY, value VARCHAR(128), hits INTEGER)" ) ) );
+
+        for ( int i = 0; i < 2; ++i ) {
+            SqlInsertQueryBuilder qb;
+            qb.setTable( QL1S("upsert1") );
+            qb.addColumnValue( QL1S("key"), 1 );
+            qb.addColumnValue( QL1S("value"), QString::number( i ) );
+            qb.addColumnValue( QL1S("hits"), 1 );
+            qb.setOnConflict( QStringList() << QL1S("key"), SqlInsertQueryBuilder::ConflictDoUpdate );
+            qb.addConflictUpdateColumn( QL1S("value") );
+            qb.addConflictUpdateColumnValue( QL1S("hits"), 2 );
+            qb.exec();
+        }
+
+        SqlInsertQueryBuilder qb;
+        qb.setTable( QL1S("upsert1") );
+        qb.addColumnValue( QL1S("key"), 1 );
+        qb.addColumnValue( QL1S("value"), QL1S("ignored") );
+        qb.setOnConflict( QStringList(), SqlInsertQueryBuilder::ConflictDoNothing );
+        qb.exec();
+
+        QVERIFY( query.exec( QLatin1String( "SELECT count(*), max(value), max(hits) FROM upsert1" ) ) );
+        QVERIFY( query.next() );
+        QCOMPARE( query.value( 0 ).toInt(), 1 );
+        QCOMPARE( query.value( 1 ).toString(), QString::fromLatin1( "1" ) );
+        QCOMPARE( query.value( 2 ).toInt(), 2 );
+    }
+
+    void testReturning()
+    {
+        QSqlQuery query;
+        QVERIFY( query.exec( QLatin1String( "CREATE TABLE returning1 (id SERIAL PRIMARY KEY, value VARCHAR(128))" ) ) );
+
+        SqlInsertQueryBuilder qb;
+        qb.setTable( QL1S("returning1") );
+        qb.addColumnValue( QL1S("value"), QL1S("first") );
+        qb.addReturningColumn( QL1S("id") );
+        qb.addReturningColumn( QL1S("value") );
+        qb.exec();
+        QVERIFY( qb.query().next() );
+        const int id = qb.query().value( 0 ).toInt();
+        QVERIFY( id > 0 );
+        QCOMPARE( qb.query().value( 1 ).toString(), QString::fromLatin1( "first" ) );
+
+        QVERIFY( query.exec( QLatin1String( "SELECT value FROM returning1 WHERE id = " ) + QString::number( id ) ) );
+        QVERIFY( query.next() );
+        QCOMPARE( query.value( 0 ).toString(), QString::fromLatin1( "first" ) );
+    }
 };
 
 QTEST_MAIN( InsertQueryBuilderTest )
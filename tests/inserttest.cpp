@@ -67,6 +67,74 @@ private Q_SLOTS:
                 << (QVector<QVariant>() << false << QDateTime(QDate(2013, 1, 1)));
     }
 
+    void testInsertRows()
+    {
+        SqlInsertQueryBuilder qb = insert()
+            .into( Person )
+            .row( Person.PersonForename << QString::fromLatin1( "Ford" ) & Person.PersonSurname << QString::fromLatin1( "Prefect" ) )
+            .row( Person.PersonForename << QString::fromLatin1( "Arthur" ) & Person.PersonSurname << QString::fromLatin1( "Dent" ) )
+            .queryBuilder();
+        qb.query(); // trigger query assembly
+        QCOMPARE( qb.m_queryString, QString::fromLatin1( "INSERT INTO tblPerson (PersonForename,PersonSurname) VALUES (:0,:1),(:2,:3)" ) );
+        QCOMPARE( qb.m_rows.size(), 2 );
+        QCOMPARE( qb.m_rows.at( 1 ), QVector<QVariant>() << QString::fromLatin1( "Arthur" ) << QString::fromLatin1( "Dent" ) );
+    }
+
+    void testInsertOnConflict()
+    {
+        const QUuid id = QUuid::createUuid();
+        SqlInsertQueryBuilder qb = insert()
+            .into( Person )
+            .columns( Person.id << id & Person.PersonSurname << QString::fromLatin1( "Prefect" ) )
+            .onConflict( Person.id )
+            .doNothing()
+            .queryBuilder();
+        qb.query(); // trigger query assembly
+        QCOMPARE( qb.m_queryString, QString::fromLatin1( "INSERT INTO tblPerson (id,PersonSurname) VALUES (:0,:1) ON CONFLICT (id) DO NOTHING" ) );
+
+        qb = insert()
+            .into( Person )
+            .columns( Person.UserName << QString::fromLatin1( "ford" ) & Person.PersonSurname << QString::fromLatin1( "Prefect" ) )
+            .onConflict( Person.UserName )
+            .doUpdate( Person.PersonSurname & Person.PersonForename << QString::fromLatin1( "Ford" ) )
+            .queryBuilder();
+        qb.query();
+        QCOMPARE( qb.m_queryString, QString::fromLatin1( "INSERT INTO tblPerson (UserName,PersonSurname) VALUES (:0,:1) "
+                                                         "ON CONFLICT (UserName) DO UPDATE SET PersonSurname = EXCLUDED.PersonSurname, PersonForename = :3" ) );
+        QCOMPARE( qb.m_conflictUpdates.size(), 2 );
+        QCOMPARE( qb.m_conflictUpdates.at( 1 ).value, QVariant( QString::fromLatin1( "Ford" ) ) );
+
+        // multi-column UniqueConstraint, with multiple rows
+        qb = insert()
+            .into( WorkTask )
+            .row( WorkTask.foreign_id << id & WorkTask.ealStart << QDateTime( QDate( 2013, 1, 1 ) ) )
+            .row( WorkTask.foreign_id << id & WorkTask.ealStart << QDateTime( QDate( 2013, 1, 2 ) ) )
+            .onConflict( WorkTask.ealEnd, WorkTask.foreign_id )
+            .doUpdate( WorkTask.ealStart )
+            .queryBuilder();
+        qb.query();
+        QCOMPARE( qb.m_queryString, QString::fromLatin1( "INSERT INTO tblWorkTask (foreign_id,ealStart) VALUES (:0,:1),(:2,:3) "
+                                                         "ON CONFLICT (ealEnd,foreign_id) DO UPDATE SET ealStart = EXCLUDED.ealStart" ) );
+
+        // unique columns of other tables are no conflict target
+        BOOST_MPL_ASSERT(( detail::is_conflict_target<PersonType, PersonType::idType> ));
+        BOOST_MPL_ASSERT_NOT(( detail::is_conflict_target<PersonType, PrefixType::idType> ));
+        BOOST_MPL_ASSERT_NOT(( detail::is_conflict_target<WorkTaskType, PersonType::idType, WorkTaskType::foreign_idType> ));
+    }
+
+    void testInsertReturning()
+    {
+        SqlInsertQueryBuilder qb = insert()
+            .into( Person )
+            .columns( Person.PersonSurname << QString::fromLatin1( "Prefect" ) )
+            .onConflict( Person.UserName )
+            .doNothing()
+            .returning( Person.id, Person.Hired )
+            .queryBuilder();
+        qb.query(); // trigger query assembly
+        QCOMPARE( qb.m_queryString, QString::fromLatin1( "INSERT INTO tblPerson (PersonSurname) VALUES (:0) ON CONFLICT (UserName) DO NOTHING RETURNING id, Hired" ) );
+    }
+
     void testInsert()
     {
         QFETCH( SqlInsertQueryBuilder, qb );
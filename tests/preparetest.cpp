@@ -0,0 +1,109 @@
+#include "testschema.h"
+#include "testbase.h"
+#include "Sql.h"
+#include "SqlDelete.h"
+#include "SqlInsert.h"
+#include "SqlPrepare.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace Sql;
+
+class PrepareTest : public TestBase
+{
+    Q_OBJECT
+private:
+    void insertPrefix( const QString &shortDesc, const QString &desc )
+    {
+        SqlQuery q = insert().into( Prefix ).columns( Prefix.id << QUuid::createUuid() & Prefix.shortDescription << shortDesc & Prefix.description << desc );
+        q.exec();
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        openDbTest();
+        createEmptyDb();
+        insertPrefix( QLatin1String( "Mr" ), QLatin1String( "Mister" ) );
+        insertPrefix( QLatin1String( "Dr" ), QLatin1String( "Doctor" ) );
+    }
+
+    void testPlaceholderName()
+    {
+        QCOMPARE( placeholder( "foo" ).m_name, QString::fromLatin1( ":foo" ) );
+        QCOMPARE( placeholder( ":foo" ).m_name, QString::fromLatin1( ":foo" ) );
+    }
+
+    void testSelect()
+    {
+        auto stmt = prepare( select( Prefix.description ).from( Prefix ).where( Prefix.shortDescription == placeholder( "sd" ) ) );
+        const QString preparedStatement = stmt.query().lastQuery();
+
+        SqlQuery &q = stmt.exec( QString::fromLatin1( "Mr" ) );
+        QVERIFY( q.next() );
+        QCOMPARE( q.value( 0 ).toString(), QString::fromLatin1( "Mister" ) );
+        QVERIFY( !q.next() );
+
+        stmt.exec( QString::fromLatin1( "Dr" ) );
+        QVERIFY( stmt.query().next() );
+        QCOMPARE( stmt.query().value( 0 ).toString(), QString::fromLatin1( "Doctor" ) );
+
+        // prepared only once
+        QCOMPARE( stmt.query().lastQuery(), preparedStatement );
+    }
+
+    void testMultiplePlaceholders()
+    {
+        auto stmt = prepare( select( Prefix.description ).from( Prefix )
+            .where( Prefix.shortDescription == placeholder( "sd" ) || Prefix.description == placeholder( "d" ) )
+            .orderBy( Prefix.description ) );
+        SqlQuery &q = stmt.exec( QString::fromLatin1( "Mr" ), QString::fromLatin1( "Doctor" ) );
+        QCOMPARE( q.size(), 2 );
+
+        stmt.exec( SqlNull, QString::fromLatin1( "Doctor" ) );
+        QCOMPARE( stmt.query().size(), 1 );
+    }
+
+    void testNestedPlaceholders()
+    {
+        auto stmt = prepare( select( Prefix.description ).from( Prefix )
+            .where( ( Prefix.shortDescription == placeholder( "sd" ) || Prefix.description == placeholder( "d" ) )
+                    && Prefix.description == placeholder( "d2" ) ) );
+        SqlQuery &q = stmt.exec( QString::fromLatin1( "Mr" ), QString::fromLatin1( "Doctor" ), QString::fromLatin1( "Mister" ) );
+        QVERIFY( q.next() );
+        QCOMPARE( q.value( 0 ).toString(), QString::fromLatin1( "Mister" ) );
+        QVERIFY( !q.next() );
+
+        stmt.exec( QString::fromLatin1( "Mr" ), QString::fromLatin1( "Doctor" ), QString::fromLatin1( "Doctor" ) );
+        QCOMPARE( stmt.query().size(), 1 );
+    }
+
+    void testRepeatedPlaceholder()
+    {
+        auto stmt = prepare( select( Prefix.description ).from( Prefix )
+            .where( Prefix.shortDescription == placeholder( "text" ) || Prefix.description == placeholder( "text" ) ) );
+        SqlQuery &q = stmt.exec( QString::fromLatin1( "Doctor" ), QString::fromLatin1( "Doctor" ) );
+        QVERIFY( q.next() );
+        QCOMPARE( q.value( 0 ).toString(), QString::fromLatin1( "Doctor" ) );
+        QVERIFY( !q.next() );
+
+        // only the first occurrence is bound
+        stmt.exec( QString::fromLatin1( "Mr" ), QString::fromLatin1( "Doctor" ) );
+        QVERIFY( stmt.query().next() );
+        QCOMPARE( stmt.query().value( 0 ).toString(), QString::fromLatin1( "Mister" ) );
+        QVERIFY( !stmt.query().next() );
+    }
+
+    void testDelete()
+    {
+        insertPrefix( QLatin1String( "Prof" ), QLatin1String( "Professor" ) );
+        auto stmt = prepare( del().from( Prefix ).where( Prefix.shortDescription == placeholder( "sd" ) ) );
+        QCOMPARE( stmt.exec( QString::fromLatin1( "Prof" ) ).numRowsAffected(), 1 );
+        QCOMPARE( stmt.exec( QString::fromLatin1( "Prof" ) ).numRowsAffected(), 0 );
+    }
+};
+
+QTEST_MAIN( PrepareTest )
+
+#include "preparetest.moc"
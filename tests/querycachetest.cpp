@@ -0,0 +1,248 @@
+#include "testschema.h"
+#include "testbase.h"
+#include "SqlQuery.h"
+#include "SqlQueryCache.h"
+#include "SqlQueryWarmup.h"
+#include "SqlSelect.h"
+#include "SqlSelectQueryBuilder.h"
+#include "SqlTransaction.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace Sql;
+
+class QueryCacheTest : public TestBase
+{
+    Q_OBJECT
+private:
+    QString connectionName() const
+    {
+        return QSqlDatabase::database().connectionName();
+    }
+
+    void prepareStatement( const QString &stmt )
+    {
+        SqlQueryCache::checkout( QSqlDatabase::database(), stmt );
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        openDbTest();
+        createEmptyDb();
+    }
+
+    void init()
+    {
+        SqlQueryCache::setCapacity( connectionName(), 1000, 16 * 1024 * 1024 );
+        SqlQueryCache::setMaxInstancesPerStatement( 4 );
+        SqlQueryCache::clear();
+    }
+
+    void testStatistics()
+    {
+        const SqlQueryCache::Statistics before = SqlQueryCache::statistics( connectionName() );
+        prepareStatement( QLatin1String( "SELECT 1" ) );
+        prepareStatement( QLatin1String( "SELECT 1" ) );
+        prepareStatement( QLatin1String( "SELECT 2" ) );
+
+        const SqlQueryCache::Statistics after = SqlQueryCache::statistics( connectionName() );
+        QCOMPARE( after.hits - before.hits, quint64( 1 ) );
+        QCOMPARE( after.misses - before.misses, quint64( 2 ) );
+        QCOMPARE( after.entries, 2 );
+        QVERIFY( after.bytes > 0 );
+    }
+
+    void testLruEviction()
+    {
+        SqlQueryCache::setCapacity( connectionName(), 2, 16 * 1024 * 1024 );
+        const quint64 evictions = SqlQueryCache::statistics( connectionName() ).evictions;
+
+        prepareStatement( QLatin1String( "SELECT 1" ) );
+        prepareStatement( QLatin1String( "SELECT 2" ) );
+        prepareStatement( QLatin1String( "SELECT 1" ) ); // makes "SELECT 2" the least recently used one
+        prepareStatement( QLatin1String( "SELECT 3" ) );
+
+        QVERIFY( SqlQueryCache::contains( connectionName(), QLatin1String( "SELECT 1" ) ) );
+        QVERIFY( SqlQueryCache::contains( connectionName(), QLatin1String( "SELECT 3" ) ) );
+        QVERIFY( !SqlQueryCache::contains( connectionName(), QLatin1String( "SELECT 2" ) ) );
+
+        const SqlQueryCache::Statistics stats = SqlQueryCache::statistics( connectionName() );
+        QCOMPARE( stats.entries, 2 );
+        QCOMPARE( stats.evictions - evictions, quint64( 1 ) );
+    }
+
+    void testContainsRefreshesRecency()
+    {
+        SqlQueryCache::setCapacity( connectionName(), 2, 16 * 1024 * 1024 );
+        prepareStatement( QLatin1String( "SELECT 1" ) );
+        prepareStatement( QLatin1String( "SELECT 2" ) );
+        QVERIFY( SqlQueryCache::contains( connectionName(), QLatin1String( "SELECT 1" ) ) ); // makes "SELECT 2" the least recently used one
+        prepareStatement( QLatin1String( "SELECT 3" ) );
+
+        QVERIFY( SqlQueryCache::contains( connectionName(), QLatin1String( "SELECT 1" ) ) );
+        QVERIFY( !SqlQueryCache::contains( connectionName(), QLatin1String( "SELECT 2" ) ) );
+    }
+
+    void testByteLimit()
+    {
+        SqlQueryCache::setCapacity( connectionName(), 1000, 0 );
+        prepareStatement( QLatin1String( "SELECT 1" ) );
+        QVERIFY( !SqlQueryCache::contains( connectionName(), QLatin1String( "SELECT 1" ) ) );
+        QCOMPARE( SqlQueryCache::statistics( connectionName() ).entries, 0 );
+    }
+
+    void testInvalidateTables()
+    {
+        const QString personStmt = QLatin1String( "SELECT id FROM tblPerson" );
+        const QString reportStmt = QLatin1String( "SELECT id FROM tblReport" );
+        prepareStatement( personStmt );
+        prepareStatement( reportStmt );
+
+        SqlQueryCache::invalidateTables( QStringList() << QLatin1String( "tblperson" ) );
+        QVERIFY( !SqlQueryCache::contains( connectionName(), personStmt ) );
+        QVERIFY( SqlQueryCache::contains( connectionName(), reportStmt ) );
+    }
+
+    void testClearConnection()
+    {
+        prepareStatement( QLatin1String( "SELECT 1" ) );
+        SqlQueryCache::clear( QLatin1String( "not-the-test-connection" ) );
+        QVERIFY( SqlQueryCache::contains( connectionName(), QLatin1String( "SELECT 1" ) ) );
+        SqlQueryCache::clear( connectionName() );
+        QVERIFY( !SqlQueryCache::contains( connectionName(), QLatin1String( "SELECT 1" ) ) );
+    }
+
+    void testSchemaChangeGuard()
+    {
+        const QString personStmt = QLatin1String( "SELECT id FROM tblPerson" );
+        const QString reportStmt = QLatin1String( "SELECT id FROM tblReport" );
+        prepareStatement( personStmt );
+        prepareStatement( reportStmt );
+        {
+            SqlQueryCache::SchemaChangeGuard guard( connectionName(), QStringList() << QLatin1String( "tblPerson" ) );
+            QVERIFY( !SqlQueryCache::contains( connectionName(), reportStmt ) );
+        }
+        QVERIFY( !SqlQueryCache::contains( connectionName(), personStmt ) );
+        QVERIFY( SqlQueryCache::contains( connectionName(), reportStmt ) );
+    }
+
+    void testExclusiveInstances()
+    {
+        const QString stmt = QLatin1String( "SELECT CAST(:0 AS INTEGER)" );
+        SqlQuery q1 = SqlQueryCache::checkout( QSqlDatabase::database(), stmt );
+        SqlQuery q2 = SqlQueryCache::checkout( QSqlDatabase::database(), stmt );
+        q1.bindValue( QLatin1String( ":0" ), 1 );
+        q2.bindValue( QLatin1String( ":0" ), 2 );
+        q1.exec();
+        q2.exec();
+        QVERIFY( q1.next() );
+        QVERIFY( q2.next() );
+        QCOMPARE( q1.value( 0 ).toInt(), 1 );
+        QCOMPARE( q2.value( 0 ).toInt(), 2 );
+        QCOMPARE( SqlQueryCache::statistics( connectionName() ).entries, 2 );
+    }
+
+    void testInstanceReuse()
+    {
+        const QString stmt = QLatin1String( "SELECT 1" );
+        {
+            SqlQuery q = SqlQueryCache::checkout( QSqlDatabase::database(), stmt );
+            QVERIFY( !SqlQueryCache::contains( connectionName(), stmt ) );
+        }
+        QVERIFY( SqlQueryCache::contains( connectionName(), stmt ) );
+        SqlQuery q = SqlQueryCache::checkout( QSqlDatabase::database(), stmt );
+        QCOMPARE( SqlQueryCache::statistics( connectionName() ).entries, 1 );
+    }
+
+    void testInstanceLimit()
+    {
+        SqlQueryCache::setMaxInstancesPerStatement( 1 );
+        const QString stmt = QLatin1String( "SELECT 1" );
+        SqlQuery q1 = SqlQueryCache::checkout( QSqlDatabase::database(), stmt );
+        SqlQuery q2 = SqlQueryCache::checkout( QSqlDatabase::database(), stmt );
+        QCOMPARE( q2.lastQuery(), stmt );
+        QCOMPARE( SqlQueryCache::statistics( connectionName() ).entries, 1 );
+    }
+
+    void testWarmup()
+    {
+        SqlQueryWarmup::registerExpression( select( Person.PersonSurname ).from( Person ).where( Person.PersonForename == QLatin1String( "Gerald" ) ) );
+        const QString stmt = QLatin1String( "SELECT tblPerson.PersonSurname FROM tblPerson WHERE tblPerson.PersonForename = :0" );
+        QVERIFY( SqlQueryWarmup::registeredStatements().contains( stmt ) );
+
+        QVERIFY( !SqlQueryCache::contains( connectionName(), stmt ) );
+        QVERIFY( SqlQueryWarmup::warmUp( QSqlDatabase::database() ) >= 0 );
+        QVERIFY( SqlQueryCache::contains( connectionName(), stmt ) );
+
+        SqlQueryCache::clear();
+        SqlQueryWarmup *warmup = SqlQueryWarmup::warmUpInBackground( QSqlDatabase::database() );
+        QSignalSpy spy( warmup, SIGNAL(finished(int,qint64)) );
+        QVERIFY( spy.wait() );
+        QVERIFY( SqlQueryCache::contains( connectionName(), stmt ) );
+    }
+
+    void testWarmupReporting()
+    {
+        const QString stmt = QLatin1String( "SELECT tblPerson.PersonSurname FROM tblPerson WHERE tblPerson.PersonForename = :0" );
+        QVERIFY( SqlQueryWarmup::registeredStatements().contains( stmt ) );
+        QSignalSpy spy( SqlQueryWarmup::instance(), SIGNAL(warmedUp(QString,int,qint64)) );
+
+        // a statement failing to prepare would abort an open transaction
+        SqlQueryCache::clear();
+        {
+            SqlTransaction t;
+            QCOMPARE( SqlQueryWarmup::warmUp( QSqlDatabase::database() ), qint64( -1 ) );
+        }
+        QVERIFY( !SqlQueryCache::contains( connectionName(), stmt ) );
+        QCOMPARE( spy.count(), 0 );
+
+        const qint64 elapsed = SqlQueryWarmup::warmUp( QSqlDatabase::database() );
+        QVERIFY( elapsed >= 0 );
+        QVERIFY( SqlQueryCache::contains( connectionName(), stmt ) );
+        QCOMPARE( spy.count(), 1 );
+        QCOMPARE( spy.at( 0 ).at( 0 ).toString(), connectionName() );
+        QVERIFY( spy.at( 0 ).at( 1 ).toInt() >= 1 );
+        QCOMPARE( spy.at( 0 ).at( 2 ).toLongLong(), elapsed );
+    }
+
+    void testPrepareThreshold()
+    {
+        SqlQueryBuilderBase::setPrepareThreshold( 3 );
+        const QString forename = QString::fromLatin1( "O'Brien %1" ).arg( QDateTime::currentMSecsSinceEpoch() );
+        QString stmt;
+        for ( int i = 1; i <= 3; ++i ) {
+            SqlSelectQueryBuilder qb;
+            qb.setTable( Person );
+            qb.addColumn( Person.id );
+            qb.whereCondition().addValueCondition( Person.PersonForename, SqlCondition::Equals, forename );
+            qb.exec();
+            QVERIFY( !qb.query().next() );
+            stmt = qb.statement();
+
+            QCOMPARE( SqlQueryCache::executionCounts( connectionName() ).value( stmt ), i );
+            QCOMPARE( SqlQueryCache::statistics( connectionName() ).entries, i < 3 ? 0 : 1 );
+        }
+        SqlQueryBuilderBase::setPrepareThreshold( 1 );
+    }
+
+    void testOneShotRawFragments()
+    {
+        // placeholder lookalikes in literals and comments of raw fragments must survive inlining
+        SqlQueryBuilderBase::setPrepareThreshold( 2 );
+        SqlSelectQueryBuilder qb;
+        qb.setTable( Person );
+        qb.addColumnExpression( QLatin1String( "E'it\\'s :0'" ), QLatin1String( "escaped" ) );
+        qb.addColumnExpression( QLatin1String( "$tag$ :0 $tag$ /* :0 /* :0 */ */" ), QLatin1String( "dollar" ) );
+        qb.addColumnExpression( QLatin1String( "'--' -- :0\n" ), QLatin1String( "dashes" ) );
+        qb.whereCondition().addValueCondition( Person.PersonForename, SqlCondition::Equals, QString::fromLatin1( "O'Brien" ) );
+        qb.exec();
+        QVERIFY( !qb.query().next() );
+        SqlQueryBuilderBase::setPrepareThreshold( 1 );
+    }
+};
+
+QTEST_MAIN( QueryCacheTest )
+
+#include "querycachetest.moc"
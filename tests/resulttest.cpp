@@ -0,0 +1,130 @@
+#include "testschema.h"
+#include "testbase.h"
+#include "Sql.h"
+#include "SqlResult.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace Sql;
+
+class ResultTest : public TestBase
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        openDbTest();
+        createEmptyDb();
+        QSqlQuery query;
+        QVERIFY( query.exec( QLatin1String( "INSERT INTO lutPrefix (id, short_desc, description) "
+                                            "SELECT md5(i::text)::uuid, i::text, 'result' FROM generate_series(1, 10000) AS i" ) ) );
+        QVERIFY( query.exec( QLatin1String( "INSERT INTO lutPrefix (id, short_desc, description) VALUES ('00000000-0000-0000-0000-000000000001', NULL, 'null')" ) ) );
+    }
+
+    void testRows()
+    {
+        int count = 0;
+        for ( const Result<boost::mpl::vector<PrefixType::idType, PrefixType::shortDescriptionType> >::Row &row :
+              fetch( select( Prefix.id, Prefix.shortDescription ).from( Prefix ).where( Prefix.description == QString::fromLatin1( "result" ) ) ) ) {
+            QVERIFY( !std::get<0>( row ).isNull() );
+            QVERIFY( std::get<1>( row ).toInt() > 0 );
+            ++count;
+        }
+        QCOMPARE( count, 10000 );
+    }
+
+    void testValue()
+    {
+        Result<boost::mpl::vector<PrefixType::idType, PrefixType::shortDescriptionType> > result =
+            fetch( select( Prefix.id, Prefix.shortDescription ).from( Prefix ).where( Prefix.description == QString::fromLatin1( "null" ) ) );
+        QVERIFY( result.next() );
+        QCOMPARE( result.value( Prefix.id ), QUuid( QLatin1String( "{00000000-0000-0000-0000-000000000001}" ) ) );
+        QVERIFY( !result.isNull( Prefix.id ) );
+        QVERIFY( result.isNull( Prefix.shortDescription ) );
+        QVERIFY( result.value( Prefix.shortDescription ).isNull() );
+        QVERIFY( !result.next() );
+    }
+
+    void testColumns()
+    {
+        typedef boost::mpl::vector<PrefixType::idType, PrefixType::shortDescriptionType> Columns;
+        ColumnarResult<Columns> result = fetchColumns( select( Prefix.id, Prefix.shortDescription ).from( Prefix )
+                                                       .where( Prefix.description == QString::fromLatin1( "result" ) || Prefix.description == QString::fromLatin1( "null" ) )
+                                                       .orderBy( Prefix.id ) );
+        QCOMPARE( result.rowCount(), 10001 );
+        QCOMPARE( int( result.column( Prefix.id ).size() ), 10001 );
+        QCOMPARE( int( result.column( Prefix.shortDescription ).size() ), 10001 );
+        QCOMPARE( int( result.nulls( Prefix.shortDescription ).size() ), 10001 );
+
+        // the NULL row sorts first by id
+        QCOMPARE( result.column( Prefix.id ).front(), QUuid( QLatin1String( "{00000000-0000-0000-0000-000000000001}" ) ) );
+        QVERIFY( result.isNull( 0, Prefix.shortDescription ) );
+        QVERIFY( !result.isNull( 0, Prefix.id ) );
+        qint64 sum = 0;
+        for ( int row = 1; row < result.rowCount(); ++row ) {
+            QVERIFY( !result.isNull( row, Prefix.shortDescription ) );
+            sum += result.column( Prefix.shortDescription ).at( row ).toInt();
+        }
+        QCOMPARE( sum, qint64( 10000 ) * 10001 / 2 );
+    }
+
+    void testAggregates()
+    {
+        typedef decltype( count() ) CountAll;
+        typedef decltype( count( Prefix.shortDescription ) ) CountShortDescription;
+        typedef decltype( max( Prefix.shortDescription ) ) MaxShortDescription;
+        Result<boost::mpl::vector<CountAll, CountShortDescription, MaxShortDescription> > result =
+            fetch( select( count(), count( Prefix.shortDescription ), max( Prefix.shortDescription ) ).from( Prefix ) );
+        QVERIFY( result.next() );
+        QCOMPARE( result.value( count() ), 10001ll );
+        QCOMPARE( result.value( count( Prefix.shortDescription ) ), 10000ll );
+        QCOMPARE( result.value( max( Prefix.shortDescription ) ), QString::fromLatin1( "9999" ) );
+        QVERIFY( !result.next() );
+
+        typedef boost::mpl::vector<PrefixType::descriptionType, CountAll> GroupColumns;
+        ColumnarResult<GroupColumns> groups = fetchColumns( select( Prefix.description, count() ).from( Prefix )
+                                                            .groupBy( Prefix.description ).having( count() > 1 ) );
+        QCOMPARE( groups.rowCount(), 1 );
+        QCOMPARE( groups.column( Prefix.description ).front(), QString::fromLatin1( "result" ) );
+        QCOMPARE( groups.column( count() ).front(), 10000ll );
+    }
+
+    void benchmarkVariant()
+    {
+        QBENCHMARK {
+            SqlQuery query = select( Prefix.id, Prefix.shortDescription ).from( Prefix );
+            query.exec();
+            qint64 sum = 0;
+            while ( query.next() ) {
+                const QUuid id = query.value( 0 ).value<QUuid>();
+                sum += query.value( 1 ).toString().size() + id.data1;
+            }
+            QVERIFY( sum > 0 );
+        }
+    }
+
+    void benchmarkColumns()
+    {
+        typedef boost::mpl::vector<PrefixType::idType, PrefixType::shortDescriptionType> Columns;
+        QBENCHMARK {
+            ColumnarResult<Columns> result = fetchColumns( select( Prefix.id, Prefix.shortDescription ).from( Prefix ) );
+            QVERIFY( result.rowCount() > 0 );
+        }
+    }
+
+    void benchmarkTyped()
+    {
+        QBENCHMARK {
+            Result<boost::mpl::vector<PrefixType::idType, PrefixType::shortDescriptionType> > result = fetch( select( Prefix.id, Prefix.shortDescription ).from( Prefix ) );
+            qint64 sum = 0;
+            while ( result.next() )
+                sum += result.value( Prefix.shortDescription ).size() + result.value( Prefix.id ).data1;
+            QVERIFY( sum > 0 );
+        }
+    }
+};
+
+QTEST_MAIN( ResultTest )
+
+#include "resulttest.moc"
@@ -153,6 +153,38 @@ private Q_SLOTS:
         qb.whereCondition().addValueCondition(Report.ts, SqlCondition::LessOrEqual, SqlNow);
         qb.whereCondition().addValueCondition(Report.txt, SqlCondition::Is, SqlNull);
         QTest::newRow( "server side time" ) << qb << "SELECT * FROM tblReport WHERE (tblReport.ts <= now() AND tblReport.txt IS NULL)" << QVector<QVariant>();
+
+        qb = SqlSelectQueryBuilder();
+        qb.setTable( QL1S( "table1" ) );
+        qb.addAllColumns();
+        qb.addSortColumn( QL1S( "col1" ) );
+        qb.addSortColumn( QL1S( "col2" ) );
+        qb.setPageAfter( QVector<QVariant>(), 20 );
+        QTest::newRow( "keyset first page" ) << qb << "SELECT * FROM table1 ORDER BY col1 ASC, col2 ASC LIMIT :0" << ( QVector<QVariant>() << 20ll );
+
+        qb.setPageAfter( QVector<QVariant>() << QL1S( "a" ) << QL1S( "b" ), 20 );
+        QTest::newRow( "keyset same order" ) << qb << "SELECT * FROM table1 WHERE (col1, col2) > (:0, :1) ORDER BY col1 ASC, col2 ASC LIMIT :2"
+                                             << ( QVector<QVariant>() << QL1S( "a" ) << QL1S( "b" ) << 20ll );
+
+        qb = SqlSelectQueryBuilder();
+        qb.setTable( QL1S( "table1" ) );
+        qb.addAllColumns();
+        qb.whereCondition().addValueCondition( QL1S( "col4" ), SqlCondition::Equals, QL1S( "x" ) );
+        qb.addSortColumn( QL1S( "col1" ), Qt::DescendingOrder );
+        qb.addSortColumn( QL1S( "col2" ) );
+        qb.addSortColumn( QL1S( "col3" ) );
+        qb.setPageAfter( QVector<QVariant>() << QL1S( "a" ) << QL1S( "b" ) << QL1S( "c" ), 10 );
+        QTest::newRow( "keyset mixed order" ) << qb << "SELECT * FROM table1 WHERE (col4 = :0) AND ((col1 < :1) OR (col1 = :1 AND col2 > :2) "
+                                                       "OR (col1 = :1 AND col2 = :2 AND col3 > :3)) ORDER BY col1 DESC, col2 ASC, col3 ASC LIMIT :4"
+                                              << ( QVector<QVariant>() << QL1S( "x" ) << QL1S( "a" ) << QL1S( "b" ) << QL1S( "c" ) << 10ll );
+
+        qb = SqlSelectQueryBuilder();
+        qb.setTable( QL1S( "table1" ) );
+        qb.addAllColumns();
+        qb.whereCondition().addValueCondition( QL1S( "col4" ), SqlCondition::Equals, QL1S( "x" ) );
+        qb.addLimit( 40, 20 );
+        QTest::newRow( "limit" ) << qb << "SELECT * FROM table1 WHERE col4 = :0 OFFSET :1 LIMIT :2"
+                                 << ( QVector<QVariant>() << QL1S( "x" ) << 40ll << 20ll );
     }
 
     void testQueryBuilder()
@@ -167,6 +199,93 @@ private Q_SLOTS:
         QCOMPARE( qb.m_bindValues.size(), bindVals.size() );
         QVERIFY( std::equal( qb.m_bindValues.begin(), qb.m_bindValues.end(), bindVals.begin(), deepVariantCompare ) );
     }
+
+    void testFingerprint()
+    {
+        SqlSelectQueryBuilder qb1;
+        qb1.setTable( QL1S( "table1" ) );
+        qb1.addColumn( QL1S( "col1" ) );
+        qb1.whereCondition().addValueCondition( QL1S( "col2" ), SqlCondition::Equals, QL1S( "foo" ) );
+
+        SqlSelectQueryBuilder qb2 = qb1;
+        qb2.whereCondition() = SqlCondition();
+        qb2.whereCondition().addValueCondition( QL1S( "col2" ), SqlCondition::Equals, QL1S( "bar" ) );
+        QCOMPARE( qb2.fingerprint(), qb1.fingerprint() );
+
+        // NULL renders differently than a bound value
+        qb2.whereCondition() = SqlCondition();
+        qb2.whereCondition().addValueCondition( QL1S( "col2" ), SqlCondition::Equals, QVariant() );
+        QVERIFY( qb2.fingerprint() != qb1.fingerprint() );
+
+        qb2 = qb1;
+        qb2.addSortColumn( QL1S( "col1" ) );
+        QVERIFY( qb2.fingerprint() != qb1.fingerprint() );
+        qb2 = qb1;
+        qb2.addLimit( 0, 10 );
+        QVERIFY( qb2.fingerprint() != qb1.fingerprint() );
+        // all pages share one statement
+        SqlSelectQueryBuilder qb3 = qb1;
+        qb3.addLimit( 10, 10 );
+        QCOMPARE( qb3.fingerprint(), qb2.fingerprint() );
+
+        qb1.addSortColumn( QL1S( "col1" ) );
+        qb1.setPageAfter( QVector<QVariant>() << QL1S( "a" ), 10 );
+        qb2 = qb1;
+        qb2.setPageAfter( QVector<QVariant>() << QL1S( "b" ), 10 );
+        QCOMPARE( qb2.fingerprint(), qb1.fingerprint() );
+        qb2.setPageAfter( QVector<QVariant>(), 10 );
+        QVERIFY( qb2.fingerprint() != qb1.fingerprint() );
+
+        // the structure of sub-queries is part of the key, not just their hash
+        SqlSelectQueryBuilder sub1;
+        sub1.setTable( QL1S( "table2" ) );
+        sub1.addColumn( QL1S( "col3" ) );
+        SqlSelectQueryBuilder sub2 = sub1;
+        sub2.addColumn( QL1S( "col4" ) );
+        qb1 = SqlSelectQueryBuilder();
+        qb1.setTable( QL1S( "table1" ) );
+        qb1.whereCondition().addSubQueryCondition( QL1S( "col1" ), SqlCondition::In, sub1 );
+        qb2 = SqlSelectQueryBuilder();
+        qb2.setTable( QL1S( "table1" ) );
+        qb2.whereCondition().addSubQueryCondition( QL1S( "col1" ), SqlCondition::In, sub2 );
+        QVERIFY( qb1.fingerprint().isValid() );
+        QVERIFY( qb2.fingerprint() != qb1.fingerprint() );
+    }
+
+    void testRebindOnly()
+    {
+        SqlSelectQueryBuilder qb;
+        qb.setTable( QL1S( "table1" ) );
+        qb.addColumn( QL1S( "col1" ) );
+        qb.whereCondition().addValueCondition( QL1S( "col2" ), SqlCondition::Equals, QL1S( "foo" ) );
+        qb.query();
+        QCOMPARE( qb.m_queryString, QL1S( "SELECT col1 FROM table1 WHERE col2 = :0" ) );
+
+        // same structure, new value
+        qb.invalidateQuery();
+        qb.whereCondition() = SqlCondition();
+        qb.whereCondition().addValueCondition( QL1S( "col2" ), SqlCondition::Equals, QL1S( "bar" ) );
+        qb.query();
+        QCOMPARE( qb.m_queryString, QL1S( "SELECT col1 FROM table1 WHERE col2 = :0" ) );
+        QCOMPARE( qb.m_bindValues, QVector<QVariant>() << QL1S( "bar" ) );
+
+        // changed structure
+        qb.invalidateQuery();
+        qb.whereCondition().addValueCondition( QL1S( "col3" ), SqlCondition::Less, QL1S( "baz" ) );
+        qb.query();
+        QCOMPARE( qb.m_queryString, QL1S( "SELECT col1 FROM table1 WHERE (col2 = :0 AND col3 < :1)" ) );
+        QCOMPARE( qb.m_bindValues, QVector<QVariant>() << QL1S( "bar" ) << QL1S( "baz" ) );
+
+        // a new builder of known structure takes the statement from the shared memo
+        SqlSelectQueryBuilder qb2;
+        qb2.setTable( QL1S( "table1" ) );
+        qb2.addColumn( QL1S( "col1" ) );
+        qb2.whereCondition().addValueCondition( QL1S( "col2" ), SqlCondition::Equals, QL1S( "foo2" ) );
+        qb2.whereCondition().addValueCondition( QL1S( "col3" ), SqlCondition::Less, QL1S( "baz2" ) );
+        qb2.query();
+        QCOMPARE( qb2.m_queryString, qb.m_queryString );
+        QCOMPARE( qb2.m_bindValues, QVector<QVariant>() << QL1S( "foo2" ) << QL1S( "baz2" ) );
+    }
 };
 
 QTEST_MAIN( SelectQueryBuilderTest )
@@ -2,16 +2,31 @@
 #include "testschema.h"
 #include "testbase.h"
 #include "Sql.h"
+#include "SqlExceptions.h"
 #include "SqlSelect.h"
 
 #include <QObject>
 #include <QtTest/QtTest>
 
+#include <algorithm>
+
 using namespace Sql;
 
 Q_DECLARE_METATYPE( SqlSelectQueryBuilder )
 Q_DECLARE_METATYPE( QVector<QVariant> )
 
+template <typename Expr>
+static QList<QUuid> selectIds( const Expr &expr )
+{
+    SqlQuery q = expr;
+    q.exec();
+    QList<QUuid> ids;
+    while ( q.next() )
+        ids.push_back( QUuid( q.value( 0 ).toString() ) );
+    std::sort( ids.begin(), ids.end() );
+    return ids;
+}
+
 class SelectTest : public TestBase
 {
     Q_OBJECT
@@ -153,6 +168,65 @@ private Q_SLOTS:
             << "SELECT tblPerson.id FROM tblPerson WHERE tblPerson.PersonForename LIKE :0"
             << (QVector<QVariant>() << QLatin1String( "foo%" ));
 
+        QTest::newRow( "IN condition" )
+            << select( Person.id ).from( Person ).where( in( Person.PersonSurname, QStringList() << QLatin1String( "Ford" ) << QLatin1String( "Carter" ) ) ).queryBuilder()
+            << "SELECT tblPerson.id FROM tblPerson WHERE tblPerson.PersonSurname = ANY(:0)"
+            << (QVector<QVariant>() << QVariant( QVariantList() << QLatin1String( "Ford" ) << QLatin1String( "Carter" ) ));
+
+        QTest::newRow( "IN sub-query" )
+            << select( Person.id ).from( Person )
+                .where( Person.PersonSurname == QString::fromLatin1( "Ford" )
+                    && in( Person.PersonGrade, select( PersonGrades.id ).from( PersonGrades ).where( PersonGrades.description == QString::fromLatin1( "foo" ) ) ) ).queryBuilder()
+            << "SELECT tblPerson.id FROM tblPerson WHERE (tblPerson.PersonSurname = :0 AND tblPerson.fk_lutPersonGrades_id IN "
+               "(SELECT lutPersonGrades.id FROM lutPersonGrades WHERE lutPersonGrades.description = :1))"
+            << (QVector<QVariant>() << QLatin1String( "Ford" ) << QLatin1String( "foo" ));
+
+        QTest::newRow( "NOT EXISTS sub-query" )
+            << select( PersonGrades.id ).from( PersonGrades )
+                .where( notExists( select( Person.id ).from( Person ).where( Person.PersonGrade == PersonGrades.id && Person.PersonSurname == QString::fromLatin1( "Ford" ) ) )
+                    && PersonGrades.description == QString::fromLatin1( "foo" ) ).queryBuilder()
+            << "SELECT lutPersonGrades.id FROM lutPersonGrades WHERE (NOT EXISTS (SELECT tblPerson.id FROM tblPerson "
+               "WHERE (tblPerson.fk_lutPersonGrades_id = lutPersonGrades.id AND tblPerson.PersonSurname = :0)) AND lutPersonGrades.description = :1)"
+            << (QVector<QVariant>() << QLatin1String( "Ford" ) << QLatin1String( "foo" ));
+
+        QTest::newRow( "aggregates" )
+            << select( sum( Workplace.itemorder ), min( Workplace.itemorder ), max( Workplace.description ), avg( Workplace.itemorder ), count( Workplace.description ) ).from( Workplace ).queryBuilder()
+            << "SELECT SUM(tblWorkplace.itemorder), MIN(tblWorkplace.itemorder), MAX(tblWorkplace.description), AVG(tblWorkplace.itemorder), COUNT(tblWorkplace.description) FROM tblWorkplace"
+            << QVector<QVariant>();
+
+        QTest::newRow( "HAVING" )
+            << select( Person.PersonSurname, count() ).from( Person ).where( Person.PersonForename == QString::fromLatin1( "Gerald" ) )
+                .groupBy( Person.PersonSurname ).having( count() > 1 ).orderBy( count(), Qt::DescendingOrder ).queryBuilder()
+            << "SELECT tblPerson.PersonSurname, COUNT(*) FROM tblPerson WHERE tblPerson.PersonForename = :0 "
+               "GROUP BY tblPerson.PersonSurname HAVING COUNT(*) > :1 ORDER BY COUNT(*) DESC"
+            << (QVector<QVariant>() << QLatin1String( "Gerald" ) << QVariant( 1ll ));
+
+        QTest::newRow( "window functions" )
+            << select( Person.id, rank().over( orderBy( desc( Person.Hired ) ) ), lag<2>( Person.Hired ).over( partitionBy( Person.PersonGrade, Person.PersonSurname ), orderBy( Person.Hired ) ) )
+                .from( Person ).queryBuilder()
+            << "SELECT tblPerson.id, RANK() OVER (ORDER BY tblPerson.Hired DESC), "
+               "LAG(tblPerson.Hired, 2) OVER (PARTITION BY tblPerson.fk_lutPersonGrades_id, tblPerson.PersonSurname ORDER BY tblPerson.Hired) FROM tblPerson"
+            << QVector<QVariant>();
+
+        QTest::newRow( "QUALIFY" )
+            << select( Person.id, Person.PersonSurname ).from( Person ).where( Person.PersonForename == QString::fromLatin1( "Gerald" ) )
+                .qualify( rowNumber().over( partitionBy( Person.PersonGrade ), orderBy( desc( Person.Hired ), Person.id ) ) <= 2 )
+                .orderBy( Person.PersonSurname, Person.Hired ).queryBuilder()
+            << "SELECT sqlate_c0, sqlate_c1 FROM (SELECT tblPerson.id AS sqlate_c0, tblPerson.PersonSurname AS sqlate_c1, "
+               "ROW_NUMBER() OVER (PARTITION BY tblPerson.fk_lutPersonGrades_id ORDER BY tblPerson.Hired DESC, tblPerson.id) AS sqlate_c2, "
+               "tblPerson.Hired AS sqlate_c3 FROM tblPerson WHERE tblPerson.PersonForename = :0) AS sqlate_window "
+               "WHERE sqlate_c2 <= :1 ORDER BY sqlate_c1 ASC, sqlate_c3 ASC"
+            << (QVector<QVariant>() << QLatin1String( "Gerald" ) << QVariant( 2ll ));
+
+        const QUuid bossId = QUuid::createUuid();
+        QTest::newRow( "WITH RECURSIVE" )
+            << ancestors( PersonBossRelation, bossId ).queryBuilder()
+            << "WITH RECURSIVE sqlate_ancestors(id, depth) AS (SELECT rltPersonBossRelation.fk_tblPerson_id_link, 1 FROM rltPersonBossRelation "
+               "WHERE rltPersonBossRelation.fk_tblPerson_id = :0 UNION ALL SELECT rltPersonBossRelation.fk_tblPerson_id_link, sqlate_ancestors.depth + 1 "
+               "FROM rltPersonBossRelation INNER JOIN sqlate_ancestors ON rltPersonBossRelation.fk_tblPerson_id = sqlate_ancestors.id) "
+               "SELECT sqlate_ancestors.id FROM sqlate_ancestors"
+            << (QVector<QVariant>() << QVariant::fromValue( bossId ));
+
         QTest::newRow( "1 GROUP BY" )
             << select( Person.id ).from( Person ).groupBy( Person.PersonSurname, Person.id ).queryBuilder()
             << "SELECT tblPerson.id FROM tblPerson GROUP BY tblPerson.PersonSurname, tblPerson.id"
@@ -174,6 +248,265 @@ private Q_SLOTS:
         QCOMPARE( qb.m_queryString, sql );
         QCOMPARE( qb.m_bindValues, bindVals );
     }
+
+    void testStaticStatement()
+    {
+        const QString sql = QLatin1String( "SELECT tblPerson.id FROM tblPerson WHERE (tblPerson.PersonSurname = :0 AND tblPerson.PersonForename = :1) ORDER BY tblPerson.PersonSurname DESC" );
+        const detail::StaticStatement *stmt1 = select( Person.id ).from( Person )
+            .where( Person.PersonSurname == QString::fromLatin1( "Ford" ) && Person.PersonForename == QString::fromLatin1( "Gerald" ) )
+            .orderBy( Person.PersonSurname, Qt::DescendingOrder ).staticStatement();
+        QVERIFY( stmt1 );
+        QCOMPARE( stmt1->text, sql );
+        QCOMPARE( stmt1->valueCount, 2 );
+
+        // same type with different values renders only once
+        const detail::StaticStatement *stmt2 = select( Person.id ).from( Person )
+            .where( Person.PersonSurname == QString::fromLatin1( "Carter" ) && Person.PersonForename == QString::fromLatin1( "Jimmy" ) )
+            .orderBy( Person.PersonSurname, Qt::DescendingOrder ).staticStatement();
+        QCOMPARE( stmt2, stmt1 );
+
+        // the sort order is only known at runtime
+        const detail::StaticStatement *stmt3 = select( Person.id ).from( Person )
+            .where( Person.PersonSurname == QString::fromLatin1( "Ford" ) && Person.PersonForename == QString::fromLatin1( "Gerald" ) )
+            .orderBy( Person.PersonSurname, Qt::AscendingOrder ).staticStatement();
+        QVERIFY( stmt3 );
+        QVERIFY( stmt3 != stmt1 );
+        QVERIFY( stmt3->text.endsWith( QLatin1String( "ORDER BY tblPerson.PersonSurname ASC" ) ) );
+
+        // placeholder names are runtime data
+        QVERIFY( !select( Person.id ).from( Person ).where( Person.id == placeholder( ":foo" ) ).staticStatement() );
+    }
+
+    void testStaticStatementBindValues()
+    {
+        const QVector<QVariant> values = select( Person.id, PersonGrades.description ).from( Person )
+            .innerJoin( PersonGrades, Person.PersonGrade == PersonGrades.id )
+            .where( Person.PersonSurname == QString::fromLatin1( "Ford" ) || isNull( Person.PersonForename ) || like( Person.PersonForename, QLatin1String( "G%" ) ) )
+            .bindValues();
+        QCOMPARE( values, QVector<QVariant>() << QString::fromLatin1( "Ford" ) << QString::fromLatin1( "G%" ) );
+    }
+
+    void testIn()
+    {
+        // the number of values doesn't change the statement
+        const detail::StaticStatement *stmt = select( Person.id ).from( Person )
+            .where( in( Person.id, QVector<QUuid>() << QUuid::createUuid() << QUuid::createUuid() ) ).staticStatement();
+        QVERIFY( stmt );
+        QCOMPARE( stmt->text, QString::fromLatin1( "SELECT tblPerson.id FROM tblPerson WHERE tblPerson.id = ANY(:0)" ) );
+        QCOMPARE( stmt->valueCount, 1 );
+        QCOMPARE( select( Person.id ).from( Person ).where( in( Person.id, QVector<QUuid>() ) ).staticStatement(), stmt );
+
+        // the list is sent as one array literal
+        const QUuid id = QUuid::createUuid();
+        QCOMPARE( SqlQueryBuilderBase::driverValue( QVariantList() << QVariant::fromValue( id ) << QVariant() ).toString(),
+                  QString::fromLatin1( "{\"%1\",NULL}" ).arg( id.toString() ) );
+        QCOMPARE( SqlQueryBuilderBase::driverValue( QVariantList() << QString::fromLatin1( "a\"b\\c" ) << 42 ).toString(),
+                  QString::fromLatin1( "{\"a\\\"b\\\\c\",\"42\"}" ) );
+
+        SqlQuery q = select( Person.id ).from( Person ).where( in( Person.id, QVector<QUuid>() << id << QUuid::createUuid() ) );
+        q.exec();
+        QVERIFY( !q.next() );
+        SqlQuery q2 = select( Person.id ).from( Person ).where( in( Person.PersonSurname, QStringList() << QLatin1String( "Ford" ) ) && Person.PersonForename == QString::fromLatin1( "Gerald" ) );
+        q2.exec();
+        QVERIFY( !q2.next() );
+    }
+
+    void testSubQuery()
+    {
+        // sub-queries depend on runtime data of the inner expression
+        QVERIFY( !select( PersonGrades.id ).from( PersonGrades ).where( exists( select( Person.id ).from( Person ).where( Person.PersonGrade == PersonGrades.id ) ) ).staticStatement() );
+
+        // values are collected in the order they are rendered, also when re-using the statement by fingerprint
+        SqlSelectQueryBuilder qb = select( Person.id ).from( Person )
+            .where( in( Person.PersonGrade, select( PersonGrades.id ).from( PersonGrades ).where( PersonGrades.description == QString::fromLatin1( "foo" ) ) )
+                 || Person.PersonSurname == QString::fromLatin1( "Ford" ) ).queryBuilder();
+        qb.query();
+        QCOMPARE( qb.m_bindValues, QVector<QVariant>() << QLatin1String( "foo" ) << QLatin1String( "Ford" ) );
+        SqlSelectQueryBuilder qb2 = select( Person.id ).from( Person )
+            .where( in( Person.PersonGrade, select( PersonGrades.id ).from( PersonGrades ).where( PersonGrades.description == QString::fromLatin1( "bar" ) ) )
+                 || Person.PersonSurname == QString::fromLatin1( "Carter" ) ).queryBuilder();
+        qb2.query();
+        QCOMPARE( qb2.m_queryString, qb.m_queryString );
+        QCOMPARE( qb2.m_bindValues, QVector<QVariant>() << QLatin1String( "bar" ) << QLatin1String( "Carter" ) );
+
+        SqlQuery q = select( PersonGrades.id ).from( PersonGrades )
+            .where( exists( select( Person.id ).from( Person ).where( Person.PersonGrade == PersonGrades.id && Person.PersonSurname == QString::fromLatin1( "Ford" ) ) ) );
+        q.exec();
+        QVERIFY( !q.next() );
+    }
+
+    void testTraversal()
+    {
+        // the WITH part of the sub-query continues the placeholder numbering of the outer query
+        const QUuid id = QUuid::createUuid();
+        SqlSelectQueryBuilder qb = select( Person.PersonSurname ).from( Person )
+            .where( Person.PersonForename == QString::fromLatin1( "Gerald" ) && in( Person.id, descendants( PersonBossRelation, id ) ) ).queryBuilder();
+        qb.query();
+        QCOMPARE( qb.m_queryString, QString::fromLatin1( "SELECT tblPerson.PersonSurname FROM tblPerson WHERE (tblPerson.PersonForename = :0 AND tblPerson.id IN "
+            "(WITH RECURSIVE sqlate_descendants(id, depth) AS (SELECT rltPersonBossRelation.fk_tblPerson_id, 1 FROM rltPersonBossRelation "
+            "WHERE rltPersonBossRelation.fk_tblPerson_id_link = :1 UNION ALL SELECT rltPersonBossRelation.fk_tblPerson_id, sqlate_descendants.depth + 1 "
+            "FROM rltPersonBossRelation INNER JOIN sqlate_descendants ON rltPersonBossRelation.fk_tblPerson_id_link = sqlate_descendants.id) "
+            "SELECT sqlate_descendants.id FROM sqlate_descendants))" ) );
+        QCOMPARE( qb.m_bindValues.size(), 2 );
+        QCOMPARE( qb.m_bindValues.at( 1 ).value<QUuid>(), id );
+        QVERIFY( !ancestors( PersonBossRelation, id ).staticStatement() );
+
+        SqlQuery q = select( Person.PersonSurname ).from( Person ).where( in( Person.id, ancestors( PersonBossRelation, id ) ) );
+        q.exec();
+        QVERIFY( !q.next() );
+    }
+
+    void testClosureTable()
+    {
+        const QUuid root = QUuid::createUuid();
+        const QUuid child = QUuid::createUuid();
+        const QUuid leaf1 = QUuid::createUuid();
+        const QUuid leaf2 = QUuid::createUuid();
+        // relations with closure table are a single statically prepared lookup
+        QCOMPARE( ancestors( DirectoratesHierarchy, leaf1 ).queryBuilder().statement(),
+                  QString::fromLatin1( "SELECT rltDirectoratesHierarchy_closure.ancestor FROM rltDirectoratesHierarchy_closure "
+                                       "WHERE rltDirectoratesHierarchy_closure.descendant = :0" ) );
+        QVERIFY( descendants( DirectoratesHierarchy, root ).staticStatement() );
+
+        QSqlQuery q;
+        foreach ( const QUuid &id, QList<QUuid>() << root << child << leaf1 << leaf2 )
+            QVERIFY( q.exec( QString::fromLatin1( "INSERT INTO lutDirectorates (id) VALUES ('%1')" ).arg( id.toString() ) ) );
+        const QString edge = QString::fromLatin1( "INSERT INTO rltDirectoratesHierarchy (fk_lutDirectorates_id, fk_lutDirectorates_id_link) VALUES ('%1', '%2')" );
+        QVERIFY( q.exec( edge.arg( leaf1.toString(), child.toString() ) ) );
+        QVERIFY( q.exec( edge.arg( child.toString(), root.toString() ) ) );
+        QVERIFY( q.exec( edge.arg( leaf2.toString(), child.toString() ) ) );
+
+        QList<QUuid> expected = QList<QUuid>() << child << root;
+        std::sort( expected.begin(), expected.end() );
+        QCOMPARE( selectIds( ancestors( DirectoratesHierarchy, leaf1 ) ), expected );
+        expected = QList<QUuid>() << child << leaf1 << leaf2;
+        std::sort( expected.begin(), expected.end() );
+        QCOMPARE( selectIds( descendants( DirectoratesHierarchy, root ) ), expected );
+
+        // removing a relation row removes the paths through it
+        QVERIFY( q.exec( QString::fromLatin1( "DELETE FROM rltDirectoratesHierarchy WHERE fk_lutDirectorates_id = '%1'" ).arg( child.toString() ) ) );
+        QCOMPARE( selectIds( ancestors( DirectoratesHierarchy, leaf1 ) ), QList<QUuid>() << child );
+        QVERIFY( selectIds( descendants( DirectoratesHierarchy, root ) ).isEmpty() );
+
+        // re-running the statements keeps a filled closure table as it is
+        QVERIFY( q.exec( QString::fromLatin1( "SELECT count(*), sum(paths) FROM rltDirectoratesHierarchy_closure" ) ) );
+        QVERIFY( q.next() );
+        const int closureRows = q.value( 0 ).toInt();
+        const int closurePaths = q.value( 1 ).toInt();
+        foreach ( const QString &stmt, createTableTriggerStatements( DirectoratesHierarchy ) )
+            QVERIFY( q.exec( stmt ) );
+        QVERIFY( q.exec( QString::fromLatin1( "SELECT count(*), sum(paths) FROM rltDirectoratesHierarchy_closure" ) ) );
+        QVERIFY( q.next() );
+        QCOMPARE( q.value( 0 ).toInt(), closureRows );
+        QCOMPARE( q.value( 1 ).toInt(), closurePaths );
+
+        // an empty closure table is filled from the relation
+        QVERIFY( q.exec( QString::fromLatin1( "DELETE FROM rltDirectoratesHierarchy_closure" ) ) );
+        foreach ( const QString &stmt, createTableTriggerStatements( DirectoratesHierarchy ) )
+            QVERIFY( q.exec( stmt ) );
+        expected = QList<QUuid>() << leaf1 << leaf2;
+        std::sort( expected.begin(), expected.end() );
+        QCOMPARE( selectIds( descendants( DirectoratesHierarchy, child ) ), expected );
+        QVERIFY( q.exec( QString::fromLatin1( "SELECT count(*), sum(paths) FROM rltDirectoratesHierarchy_closure" ) ) );
+        QVERIFY( q.next() );
+        QCOMPARE( q.value( 0 ).toInt(), closureRows );
+        QCOMPARE( q.value( 1 ).toInt(), closurePaths );
+    }
+
+    void testQualifyPageAfter()
+    {
+        // the keyset condition and the limit apply to the filtered rows
+        const QUuid id = QUuid::createUuid();
+        SqlSelectQueryBuilder qb = select( Person.id ).from( Person )
+            .qualify( rank().over( partitionBy( Person.PersonGrade ), orderBy( desc( Person.Hired ) ) ) == 1 )
+            .orderBy( Person.id ).pageAfter( 10, id ).queryBuilder();
+        qb.query();
+        QCOMPARE( qb.m_queryString, QString::fromLatin1( "SELECT sqlate_c0 FROM (SELECT tblPerson.id AS sqlate_c0, "
+                                                         "RANK() OVER (PARTITION BY tblPerson.fk_lutPersonGrades_id ORDER BY tblPerson.Hired DESC) AS sqlate_c1 "
+                                                         "FROM tblPerson) AS sqlate_window WHERE (sqlate_c1 = :0) AND sqlate_c0 > :1 ORDER BY sqlate_c0 ASC LIMIT :2" ) );
+        QCOMPARE( qb.m_bindValues.size(), 3 );
+        QCOMPARE( qb.m_bindValues.at( 0 ), QVariant( 1ll ) );
+        QCOMPARE( qb.m_bindValues.at( 1 ).value<QUuid>(), id );
+        QCOMPARE( qb.m_bindValues.at( 2 ), QVariant( 10ll ) );
+
+        // same order when re-using the statement by fingerprint
+        SqlSelectQueryBuilder qb2 = select( Person.id ).from( Person )
+            .qualify( rank().over( partitionBy( Person.PersonGrade ), orderBy( desc( Person.Hired ) ) ) == 2 )
+            .orderBy( Person.id ).pageAfter( 20, id ).queryBuilder();
+        qb2.query();
+        QCOMPARE( qb2.m_queryString, qb.m_queryString );
+        QCOMPARE( qb2.m_bindValues.at( 0 ), QVariant( 2ll ) );
+        QCOMPARE( qb2.m_bindValues.at( 2 ), QVariant( 20ll ) );
+    }
+
+    void testAggregateTypes()
+    {
+        // COUNT is never NULL, the other aggregates are for an empty set
+        BOOST_MPL_ASSERT(( Aggregate<detail::CountFunction, detail::missing, qlonglong>::notNull ));
+        BOOST_MPL_ASSERT_NOT(( Aggregate<detail::SumFunction, WorkplaceType::itemorderType, qlonglong>::notNull ));
+        // no precision loss for sums of bigint columns
+        BOOST_MPL_ASSERT(( boost::is_same<detail::sum_type<qlonglong>::type, qlonglong> ));
+        QCOMPARE( detail::aggregate_cast<detail::SumFunction, WorkplaceType::itemorderType>::clause(), QString() );
+    }
+
+    void testQualifyUnsupported()
+    {
+        // neither can refer to the aliased columns of the derived table
+        SqlSelectQueryBuilder all;
+        all.setTable( Person );
+        all.addAllColumns();
+        all.qualifyCondition().addValueCondition( QLatin1String( "ROW_NUMBER() OVER ()" ), SqlCondition::LessOrEqual, 2 );
+        bool thrown = false;
+        try {
+            all.statement();
+        } catch ( const SqlException & ) {
+            thrown = true;
+        }
+        QVERIFY( thrown );
+
+        SqlSelectQueryBuilder distinctOn;
+        distinctOn.setTable( Person );
+        distinctOn.addColumn( Person.id );
+        distinctOn.setDistinctOn( QLatin1String( "tblPerson.PersonSurname" ) );
+        distinctOn.qualifyCondition().addValueCondition( QLatin1String( "ROW_NUMBER() OVER ()" ), SqlCondition::LessOrEqual, 2 );
+        thrown = false;
+        try {
+            distinctOn.statement();
+        } catch ( const SqlException & ) {
+            thrown = true;
+        }
+        QVERIFY( thrown );
+    }
+
+    void testPageAfter()
+    {
+        const QUuid id = QUuid::createUuid();
+        SqlSelectQueryBuilder qb = select( Person.id ).from( Person )
+            .where( Person.PersonForename == QString::fromLatin1( "Ford" ) )
+            .orderBy( Person.PersonSurname, Qt::AscendingOrder, Person.id, Qt::DescendingOrder )
+            .pageAfter( 50, QString::fromLatin1( "Prefect" ), id )
+            .queryBuilder();
+        qb.query(); // trigger query assembly
+        QCOMPARE( qb.m_queryString, QString::fromLatin1( "SELECT tblPerson.id FROM tblPerson WHERE (tblPerson.PersonForename = :0) AND "
+                                                         "((tblPerson.PersonSurname > :1) OR (tblPerson.PersonSurname = :1 AND tblPerson.id < :2)) "
+                                                         "ORDER BY tblPerson.PersonSurname ASC, tblPerson.id DESC LIMIT :3" ) );
+        QCOMPARE( qb.m_bindValues.size(), 4 );
+        QCOMPARE( qb.m_bindValues.at( 2 ).value<QUuid>(), id );
+
+        // first and later pages have different statements, but all pages of a kind share one
+        const detail::StaticStatement *first = select( Person.id ).from( Person ).orderBy( Person.id ).pageAfter( 50 ).staticStatement();
+        QVERIFY( first );
+        QCOMPARE( first->text, QString::fromLatin1( "SELECT tblPerson.id FROM tblPerson ORDER BY tblPerson.id ASC LIMIT :0" ) );
+        QCOMPARE( select( Person.id ).from( Person ).orderBy( Person.id ).pageAfter( 25 ).staticStatement(), first );
+        const detail::StaticStatement *next = select( Person.id ).from( Person ).orderBy( Person.id ).pageAfter( 50, id ).staticStatement();
+        QVERIFY( next );
+        QVERIFY( next != first );
+        QCOMPARE( next->text, QString::fromLatin1( "SELECT tblPerson.id FROM tblPerson WHERE tblPerson.id > :0 ORDER BY tblPerson.id ASC LIMIT :1" ) );
+        const QVector<QVariant> values = select( Person.id ).from( Person ).orderBy( Person.id ).pageAfter( 50, id ).bindValues();
+        QCOMPARE( values.size(), next->valueCount );
+        QCOMPARE( values.at( 0 ).value<QUuid>(), id );
+        QCOMPARE( values.at( 1 ), QVariant( 50ll ) );
+    }
 };
 
 QTEST_MAIN( SelectTest )
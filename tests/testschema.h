@@ -110,6 +110,13 @@ UNIQUE_RECURSIVE_RELATION( PersonBossRelation, Person, id, TEST_EXPORT ) {
     typedef append<baseColumns, boost::mpl::vector<expiresType> >::type columns;
 };
 
+RECURSIVE_RELATION( DirectoratesHierarchy, Directorates, id, TEST_EXPORT ) {
+    ADMIN_GROUP("sqladmins")
+    USER_GROUP("sqlusers")
+    CLOSURE_TABLE
+    SQL_NAME( "rltDirectoratesHierarchy" );
+};
+
 TABLE( WorkTask, TEST_EXPORT ) {
     ADMIN_GROUP("sqladmins")
     USER_GROUP("sqlusers")
@@ -146,7 +153,7 @@ TABLE( Report, TEST_EXPORT ) {
     typedef boost::mpl::vector<idType, tsType, txtType> columns;
 };
 
-#define SCHEMA (Version)(Prefix)(PersonRoles)(PersonSubRoles)(PersonGrades)(Person)(PersonSubRolesRelation)(Directorates)(SubDirectorates)(PersonSubDirectoratesRelation)(PersonBossRelation)(WorkTask)(Workplace)(Report)
+#define SCHEMA (Version)(Prefix)(PersonRoles)(PersonSubRoles)(PersonGrades)(Person)(PersonSubRolesRelation)(Directorates)(SubDirectorates)(PersonSubDirectoratesRelation)(PersonBossRelation)(DirectoratesHierarchy)(WorkTask)(Workplace)(Report)
 DECLARE_SCHEMA( SQLateTestSchema, SCHEMA );
 }
 
@@ -112,6 +112,34 @@ private Q_SLOTS:
         QCOMPARE( qb.m_bindValues.size(), values.size() );
         QVERIFY( std::equal( qb.m_bindValues.begin(), qb.m_bindValues.end(), values.begin(), deepVariantCompare ) );
     }
+
+    void testExecBatch()
+    {
+        QSqlQuery query;
+        for ( int i = 0; i < 3; ++i )
+            QVERIFY( query.exec( QString::fromLatin1( "INSERT INTO table1 (first, second) VALUES ('batch', %1)" ).arg( i ) ) );
+
+        SqlUpdateQueryBuilder qb;
+        qb.setTable( QL1S("table1") );
+        qb.addColumnValue( QL1S("first"), QL1S("placeholder") );
+        qb.whereCondition().addValueCondition( QL1S("second"), SqlCondition::Equals, 0 );
+        qb.whereCondition().addPlaceholderCondition( QL1S("first"), SqlCondition::Equals, QL1S(":old") );
+
+        QVector<QVariantList> values;
+        values << ( QVariantList() << QL1S("batch0") << QL1S("batch1") << QL1S("batch2") );
+        values << ( QVariantList() << 0 << 1 << 2 );
+        QHash<QString, QVariantList> namedValues;
+        namedValues.insert( QL1S(":old"), QVariantList() << QL1S("batch") << QL1S("batch") << QL1S("batch") );
+        qb.execBatch( values, namedValues );
+
+        QVERIFY( query.exec( QLatin1String( "SELECT first, second FROM table1 WHERE first LIKE 'batch%' ORDER BY second" ) ) );
+        for ( int i = 0; i < 3; ++i ) {
+            QVERIFY( query.next() );
+            QCOMPARE( query.value( 0 ).toString(), QString( QL1S("batch") + QString::number( i ) ) );
+            QCOMPARE( query.value( 1 ).toInt(), i );
+        }
+        QVERIFY( !query.next() );
+    }
 };
 
 QTEST_MAIN( UpdateQueryBuilderTest )